@@ -31,18 +31,42 @@
 #endif
 
 #include <cstddef>
+#include <algorithm>
 #include <cstdint>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/device.hpp>
 #include <vpnes/core/bus.hpp>
 #include <vpnes/core/mboard.hpp>
+#include <vpnes/core/frontend.hpp>
+#include <vpnes/core/cpu.hpp>
+#include <vpnes/core/blip.hpp>
+#include <vpnes/core/apu_channels.hpp>
 
 namespace vpnes {
 
 namespace core {
 
+namespace apu {
+
+/**
+ * Mixer parameters
+ */
+enum {
+	MixScale = 28000,  //!< Output of all channels at full volume
+	PulseLevels = 31,  //!< Sums of both pulse levels
+	TNDLevels = 203    //!< Weighted sums of triangle, noise and DMC levels
+};
+
+}  // namespace apu
+
 /**
  * Basic APU
+ *
+ * Channels are advanced lazily when the CPU accesses the registers or an
+ * APU event fires (frame IRQ, DMC fetch, end of frame). Between cycles
+ * where something happens the timers are skipped in closed form, and
+ * amplitude steps are emitted into a band-limited buffer only when the
+ * mixed output changes.
  */
 class CAPU : public CEventDevice {
 public:
@@ -96,10 +120,388 @@ public:
 	};
 
 private:
+	/**
+	 * Motherboard
+	 */
+	CMotherBoard *m_MotherBoard;
+	/**
+	 * CPU
+	 */
+	CCPU *m_CPU;
 	/**
 	 * IO Buffer
 	 */
 	std::uint8_t m_IOBuf;
+	/**
+	 * Time of the next CPU cycle
+	 */
+	ticks_t m_InternalClock;
+	/**
+	 * First pulse channel
+	 */
+	apu::CPulse m_Pulse1;
+	/**
+	 * Second pulse channel
+	 */
+	apu::CPulse m_Pulse2;
+	/**
+	 * Triangle channel
+	 */
+	apu::CTriangle m_Triangle;
+	/**
+	 * Noise channel
+	 */
+	apu::CNoise m_Noise;
+	/**
+	 * Delta modulation channel
+	 */
+	apu::CDMC m_DMC;
+	/**
+	 * Frame counter uses 5-step sequence
+	 */
+	bool m_FiveStep;
+	/**
+	 * Frame IRQ is inhibited
+	 */
+	bool m_IRQInhibit;
+	/**
+	 * Frame IRQ flag
+	 */
+	bool m_FrameIRQ;
+	/**
+	 * CPU cycle of the frame sequence
+	 */
+	int m_FrameCycle;
+	/**
+	 * CPU cycles left till sequence reset or 0
+	 */
+	int m_FrameReset;
+	/**
+	 * Frame IRQ event
+	 */
+	CMotherBoard::CEvent *m_FrameIRQEvent;
+	/**
+	 * DMC fetch event
+	 */
+	CMotherBoard::CEvent *m_DMCEvent;
+	/**
+	 * Band-limited output
+	 */
+	CBlipBuffer m_Blip;
+	/**
+	 * Current sample rate
+	 */
+	double m_SampleRate;
+	/**
+	 * Mixed output level
+	 */
+	int m_Output;
+	/**
+	 * Pulse mixer output for sum of pulse levels
+	 */
+	std::int16_t m_PulseMix[apu::PulseLevels];
+	/**
+	 * Triangle, noise and DMC mixer output for their weighted sum
+	 */
+	std::int16_t m_TNDMix[apu::TNDLevels];
+
+	/**
+	 * Gets mixed output level
+	 *
+	 * @return Level
+	 */
+	int mix() const {
+		return m_PulseMix[m_Pulse1.getOutput() + m_Pulse2.getOutput()] +
+		       m_TNDMix[m_Triangle.getOutput() * 3 + m_Noise.getOutput() * 2 +
+		                m_DMC.getOutput()];
+	}
+	/**
+	 * Emits output step if the level has changed
+	 *
+	 * @param time Time of change
+	 */
+	void updateOutput(ticks_t time) {
+		if (m_SampleRate > 0) {
+			int output = mix();
+			if (output != m_Output) {
+				m_Blip.addDelta(time, output - m_Output);
+				m_Output = output;
+			}
+		}
+	}
+	/**
+	 * Updates CPU IRQ line
+	 */
+	void updateIRQ() {
+		m_CPU->setIRQ(CCPU::IRQSourceFrame, m_FrameIRQ);
+		m_CPU->setIRQ(CCPU::IRQSourceDMC, m_DMC.isIRQ());
+	}
+	/**
+	 * Clocks envelopes and linear counter
+	 */
+	void clockQuarter() {
+		m_Pulse1.clockQuarter();
+		m_Pulse2.clockQuarter();
+		m_Triangle.clockQuarter();
+		m_Noise.clockQuarter();
+	}
+	/**
+	 * Clocks length counters and sweeps
+	 */
+	void clockHalf() {
+		m_Pulse1.clockHalf();
+		m_Pulse2.clockHalf();
+		m_Triangle.clockHalf();
+		m_Noise.clockHalf();
+	}
+	/**
+	 * Clocks frame counter
+	 *
+	 * @return True if channels were clocked
+	 */
+	bool clockFrame() {
+		if (m_FrameReset > 0 && --m_FrameReset == 0) {
+			m_FrameCycle = 0;
+			if (m_FiveStep) {
+				clockQuarter();
+				clockHalf();
+				return true;
+			}
+			return false;
+		}
+		bool clocked = true;
+		switch (++m_FrameCycle) {
+		case apu::FrameStep1:
+		case apu::FrameStep3:
+			clockQuarter();
+			break;
+		case apu::FrameStep2:
+			clockQuarter();
+			clockHalf();
+			break;
+		case apu::FrameStep4:
+			if (m_FiveStep) {
+				clocked = false;
+				break;
+			}
+			clockQuarter();
+			clockHalf();
+			if (!m_IRQInhibit) {
+				m_FrameIRQ = true;
+			}
+			break;
+		case apu::FrameStep5:
+			clockQuarter();
+			clockHalf();
+			break;
+		default:
+			clocked = false;
+			break;
+		}
+		if (m_FrameCycle >=
+		    (m_FiveStep ? apu::FramePeriod5 : apu::FramePeriod4)) {
+			m_FrameCycle = 0;
+		}
+		return clocked;
+	}
+	/**
+	 * Gets CPU cycles till the next frame counter action
+	 *
+	 * @return Number of cycles
+	 */
+	int getFrameDistance() const {
+		static const int steps[] = {
+		    apu::FrameStep1, apu::FrameStep2, apu::FrameStep3};
+		int next = m_FiveStep ? apu::FrameStep5 : apu::FrameStep4;
+		for (int step : steps) {
+			if (step > m_FrameCycle) {
+				next = step;
+				break;
+			}
+		}
+		if (next <= m_FrameCycle) {
+			next = m_FiveStep ? apu::FramePeriod5 : apu::FramePeriod4;
+		}
+		int distance = std::max(next - m_FrameCycle, 1);
+		if (m_FrameReset > 0) {
+			distance = std::min(distance, m_FrameReset);
+		}
+		return distance;
+	}
+	/**
+	 * Gets CPU cycles till the next cycle that needs precise simulation
+	 *
+	 * @return Number of cycles
+	 */
+	int getDistance() const {
+		if (m_DMC.isFetchNeeded()) {
+			return 1;
+		}
+		int distance = getFrameDistance();
+		if (!m_DMC.isIdle()) {
+			distance = std::min(distance, m_DMC.getDistance());
+		}
+		// Silent channels don't need their timer expirations
+		if (m_SampleRate > 0) {
+			if (m_Pulse1.isAudible()) {
+				distance = std::min(distance, m_Pulse1.getDistance());
+			}
+			if (m_Pulse2.isAudible()) {
+				distance = std::min(distance, m_Pulse2.getDistance());
+			}
+			if (m_Triangle.isAudible()) {
+				distance = std::min(distance, m_Triangle.getDistance());
+			}
+			if (m_Noise.isAudible()) {
+				distance = std::min(distance, m_Noise.getDistance());
+			}
+		}
+		return distance;
+	}
+	/**
+	 * Skips cycles where nothing observable happens
+	 *
+	 * @param cycles Number of cycles
+	 */
+	void skip(int cycles) {
+		if (cycles == 0) {
+			return;
+		}
+		if (m_FrameReset > 0) {
+			m_FrameReset -= cycles;
+		}
+		m_FrameCycle += cycles;
+		m_Pulse1.skip(cycles);
+		m_Pulse2.skip(cycles);
+		m_Triangle.skip(cycles);
+		m_Noise.skip(cycles);
+		m_DMC.skip(cycles);
+	}
+	/**
+	 * Simulates one CPU cycle
+	 */
+	void step() {
+		bool changed = clockFrame();
+		changed |= m_Pulse1.tick();
+		changed |= m_Pulse2.tick();
+		changed |= m_Triangle.tick();
+		changed |= m_Noise.tick();
+		changed |= m_DMC.tick();
+		if (m_DMC.isFetchNeeded()) {
+			// Sample memory has no side effects, so hooks are skipped
+			m_DMC.load(m_MotherBoard->getBusCPU()->readMemory(
+			    m_DMC.getAddress(), true));
+			m_CPU->haltDMC();
+		}
+		if (changed) {
+			updateOutput(m_InternalClock);
+		}
+		m_InternalClock += apu::CycleTime;
+	}
+	/**
+	 * Advances the channels
+	 *
+	 * @param time End time
+	 */
+	void advance(ticks_t time) {
+		while (m_InternalClock < time) {
+			int cycles = static_cast<int>(
+			    (time - m_InternalClock + apu::CycleTime - 1) / apu::CycleTime);
+			cycles = std::min(cycles, getDistance());
+			skip(cycles - 1);
+			m_InternalClock += (cycles - 1) * apu::CycleTime;
+			step();
+		}
+		updateIRQ();
+		scheduleDMC();
+	}
+	/**
+	 * Advances the channels to current CPU time
+	 */
+	void synchronize() {
+		advance(m_MotherBoard->getPending());
+	}
+	/**
+	 * Schedules frame IRQ event
+	 */
+	void scheduleFrameIRQ() {
+		if (m_FiveStep || m_IRQInhibit) {
+			m_FrameIRQEvent->setEnabled(false);
+			return;
+		}
+		int cycles;
+		if (m_FrameReset > 0) {
+			cycles = m_FrameReset - 1 + apu::FrameStep4;
+		} else {
+			cycles = apu::FrameStep4 - m_FrameCycle;
+			if (cycles <= 0) {
+				cycles += apu::FramePeriod4;
+			}
+			cycles--;
+		}
+		m_FrameIRQEvent->setFireTime(m_InternalClock + cycles * apu::CycleTime);
+		m_FrameIRQEvent->setEnabled(true);
+	}
+	/**
+	 * Schedules DMC fetch event
+	 */
+	void scheduleDMC() {
+		int distance = m_DMC.getFetchDistance();
+		if (distance < 0) {
+			if (m_DMCEvent->isEnabled()) {
+				m_DMCEvent->setEnabled(false);
+			}
+			return;
+		}
+		ticks_t time =
+		    m_InternalClock + (std::max(distance, 1) - 1) * apu::CycleTime;
+		if (m_DMCEvent->getFireTime() != time) {
+			m_DMCEvent->setFireTime(time);
+		}
+		if (!m_DMCEvent->isEnabled()) {
+			m_DMCEvent->setEnabled(true);
+		}
+	}
+	/**
+	 * Handles DMC fetch
+	 *
+	 * Fires when the sample buffer empties, so the CPU is stalled close to
+	 * the fetch instead of at the next register access.
+	 *
+	 * @param event DMC fetch event
+	 */
+	void handleDMC(CMotherBoard::CEvent *event) {
+		advance(event->getFireTime() + apu::CycleTime);
+	}
+	/**
+	 * Handles frame IRQ
+	 *
+	 * @param event Frame IRQ event
+	 */
+	void handleFrameIRQ(CMotherBoard::CEvent *event) {
+		advance(event->getFireTime() + apu::CycleTime);
+		scheduleFrameIRQ();
+	}
+	/**
+	 * Ends audio block and picks up sample rate for the next one
+	 *
+	 * @param time Block length
+	 */
+	void endAudioBlock(ticks_t time) {
+		CFrontEnd *frontEnd = m_MotherBoard->getFrontEnd();
+		if (m_SampleRate > 0) {
+			std::size_t count = m_Blip.endBlock(time);
+			frontEnd->handleAudio(m_Blip.getSamples(), count);
+		}
+		double rate = frontEnd->getSampleRate();
+		if (rate != m_SampleRate) {
+			m_SampleRate = rate;
+			if (rate > 0) {
+				m_Blip.setSampleRate(rate);
+				updateOutput(0);
+			}
+		}
+	}
 
 	/**
 	 * Reads register
@@ -107,6 +509,18 @@ private:
 	 * @param addr register address
 	 */
 	void readReg(std::uint16_t addr) {
+		if (addr != 0x4015) {
+			return;
+		}
+		synchronize();
+		m_IOBuf = (m_Pulse1.getLength().isActive() ? 0x01 : 0) |
+		          (m_Pulse2.getLength().isActive() ? 0x02 : 0) |
+		          (m_Triangle.getLength().isActive() ? 0x04 : 0) |
+		          (m_Noise.getLength().isActive() ? 0x08 : 0) |
+		          (m_DMC.isActive() ? 0x10 : 0) | (m_FrameIRQ ? 0x40 : 0) |
+		          (m_DMC.isIRQ() ? 0x80 : 0);
+		m_FrameIRQ = false;
+		updateIRQ();
 	}
 	/**
 	 * Writes to register
@@ -115,11 +529,51 @@ private:
 	 * @param addr Address
 	 */
 	void writeReg(std::uint8_t val, std::uint16_t addr) {
+		if (addr > 0x4017 || addr == 0x4014 || addr == 0x4016) {
+			return;
+		}
+		synchronize();
+		switch (addr & 0x001c) {
+		case 0x0000:
+			m_Pulse1.write(val, addr & 0x0003);
+			break;
+		case 0x0004:
+			m_Pulse2.write(val, addr & 0x0003);
+			break;
+		case 0x0008:
+			m_Triangle.write(val, addr & 0x0003);
+			break;
+		case 0x000c:
+			m_Noise.write(val, addr & 0x0003);
+			break;
+		case 0x0010:
+			m_DMC.write(val, addr & 0x0003);
+			break;
+		default:
+			if (addr == 0x4015) {
+				m_Pulse1.getLength().setEnabled(val & 0x01);
+				m_Pulse2.getLength().setEnabled(val & 0x02);
+				m_Triangle.getLength().setEnabled(val & 0x04);
+				m_Noise.getLength().setEnabled(val & 0x08);
+				m_DMC.setEnabled(val & 0x10);
+			} else {
+				m_FiveStep = val & 0x80;
+				m_IRQInhibit = val & 0x40;
+				if (m_IRQInhibit) {
+					m_FrameIRQ = false;
+				}
+				m_FrameReset = apu::FrameResetDelay;
+				scheduleFrameIRQ();
+			}
+			break;
+		}
+		updateOutput(m_InternalClock);
+		updateIRQ();
 	}
 
 protected:
 	/**
-	 * Simulation routine
+	 * Simulation routine (channels are advanced on demand)
 	 */
 	void execute() {
 	}
@@ -133,8 +587,49 @@ public:
 	 * Constructs the object
 	 *
 	 * @param motherBoard Motherboard
+	 * @param cpu CPU
+	 * @param frequency Frequency
+	 * @param frameTime Basic frame time
 	 */
-	explicit CAPU(CMotherBoard *motherBoard) : CEventDevice(), m_IOBuf() {
+	CAPU(CMotherBoard *motherBoard, CCPU *cpu, double frequency,
+	    ticks_t frameTime)
+	    : CEventDevice()
+	    , m_MotherBoard(motherBoard)
+	    , m_CPU(cpu)
+	    , m_IOBuf()
+	    , m_InternalClock(0)
+	    , m_Pulse1(true)
+	    , m_Pulse2(false)
+	    , m_Triangle()
+	    , m_Noise()
+	    , m_DMC()
+	    , m_FiveStep(false)
+	    , m_IRQInhibit(false)
+	    , m_FrameIRQ(false)
+	    , m_FrameCycle(0)
+	    , m_FrameReset(0)
+	    , m_FrameIRQEvent()
+	    , m_DMCEvent()
+	    , m_Blip(frequency, frameTime)
+	    , m_SampleRate(0)
+	    , m_Output(0)
+	    , m_PulseMix()
+	    , m_TNDMix() {
+		// The 2A03 mixes the channels through nonlinear resistor networks
+		for (int level = 1; level < apu::PulseLevels; level++) {
+			m_PulseMix[level] = static_cast<std::int16_t>(
+			    apu::MixScale * 95.52 / (8128.0 / level + 100));
+		}
+		for (int level = 1; level < apu::TNDLevels; level++) {
+			m_TNDMix[level] = static_cast<std::int16_t>(
+			    apu::MixScale * 163.67 / (24329.0 / level + 100));
+		}
+		m_FrameIRQEvent = m_MotherBoard->registerEvent(this, m_MotherBoard,
+		    "APU_FRAME_IRQ", 0, false, &CAPU::handleFrameIRQ);
+		m_DMCEvent = m_MotherBoard->registerEvent(
+		    this, m_MotherBoard, "APU_DMC", 0, false, &CAPU::handleDMC);
+		scheduleFrameIRQ();
+		endAudioBlock(0);
 	}
 	/**
 	 * Destroys the object
@@ -153,13 +648,24 @@ public:
 		}
 	}
 
+	/**
+	 * Resets the clock and ends audio block
+	 *
+	 * @param ticks Amount of ticks
+	 */
+	void resetClock(ticks_t ticks) {
+		advance(ticks);
+		endAudioBlock(ticks);
+		CEventDevice::resetClock(ticks);
+		m_InternalClock -= ticks;
+	}
 	/**
 	 * Gets pending time
 	 *
 	 * @return Pending time
 	 */
 	ticks_t getPending() const {
-		return 0;
+		return m_InternalClock;
 	}
 };
 
@@ -0,0 +1,1026 @@
+/**
+ * @file
+ *
+ * Defines APU channels
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_CORE_APU_CHANNELS_HPP_
+#define INCLUDE_VPNES_CORE_APU_CHANNELS_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+namespace apu {
+
+/**
+ * APU timings
+ */
+enum {
+	CycleTime = 12,           //!< Ticks per CPU cycle
+	FrameStep1 = 7457,        //!< First frame counter step
+	FrameStep2 = 14913,       //!< Second frame counter step
+	FrameStep3 = 22371,       //!< Third frame counter step
+	FrameStep4 = 29829,       //!< Last step of 4-step sequence
+	FramePeriod4 = 29830,     //!< Length of 4-step sequence
+	FrameStep5 = 37281,       //!< Last step of 5-step sequence
+	FramePeriod5 = 37282,     //!< Length of 5-step sequence
+	FrameResetDelay = 3       //!< Delay of sequence reset after a write
+};
+
+/**
+ * Volume envelope
+ */
+class CEnvelope {
+private:
+	/**
+	 * Restart on the next clock
+	 */
+	bool m_Start;
+	/**
+	 * Loop decay
+	 */
+	bool m_Loop;
+	/**
+	 * Use constant volume
+	 */
+	bool m_Constant;
+	/**
+	 * Constant volume or decay period
+	 */
+	std::uint8_t m_Period;
+	/**
+	 * Divider
+	 */
+	std::uint8_t m_Divider;
+	/**
+	 * Decay level
+	 */
+	std::uint8_t m_Decay;
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CEnvelope()
+	    : m_Start(false)
+	    , m_Loop(false)
+	    , m_Constant(false)
+	    , m_Period(0)
+	    , m_Divider(0)
+	    , m_Decay(0) {
+	}
+
+	/**
+	 * Writes control register
+	 *
+	 * @param val Value
+	 */
+	void write(std::uint8_t val) {
+		m_Loop = val & 0x20;
+		m_Constant = val & 0x10;
+		m_Period = val & 0x0f;
+	}
+	/**
+	 * Restarts the envelope on the next clock
+	 */
+	void restart() {
+		m_Start = true;
+	}
+	/**
+	 * Clocks the envelope (quarter frame)
+	 */
+	void clock() {
+		if (m_Start) {
+			m_Start = false;
+			m_Decay = 15;
+			m_Divider = m_Period;
+		} else if (m_Divider > 0) {
+			m_Divider--;
+		} else {
+			m_Divider = m_Period;
+			if (m_Decay > 0) {
+				m_Decay--;
+			} else if (m_Loop) {
+				m_Decay = 15;
+			}
+		}
+	}
+	/**
+	 * Gets current volume
+	 *
+	 * @return Volume
+	 */
+	std::uint8_t getVolume() const {
+		return m_Constant ? m_Period : m_Decay;
+	}
+};
+
+/**
+ * Length counter
+ */
+class CLengthCounter {
+private:
+	/**
+	 * Counter
+	 */
+	std::uint8_t m_Counter;
+	/**
+	 * Counting is halted
+	 */
+	bool m_Halt;
+	/**
+	 * Channel is enabled
+	 */
+	bool m_Enabled;
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CLengthCounter() : m_Counter(0), m_Halt(false), m_Enabled(false) {
+	}
+
+	/**
+	 * Enables or disables the channel
+	 *
+	 * @param enabled True to enable
+	 */
+	void setEnabled(bool enabled) {
+		m_Enabled = enabled;
+		if (!enabled) {
+			m_Counter = 0;
+		}
+	}
+	/**
+	 * Halts or resumes counting
+	 *
+	 * @param halt True to halt
+	 */
+	void setHalt(bool halt) {
+		m_Halt = halt;
+	}
+	/**
+	 * Loads the counter
+	 *
+	 * @param val Value written to length register
+	 */
+	void load(std::uint8_t val) {
+		static const std::uint8_t lengths[0x20] = {10, 254, 20, 2, 40, 4, 80,
+		    6, 160, 8, 60, 10, 14, 12, 26, 14, 12, 16, 24, 18, 48, 20, 96, 22,
+		    192, 24, 72, 26, 16, 28, 32, 30};
+		if (m_Enabled) {
+			m_Counter = lengths[val >> 3];
+		}
+	}
+	/**
+	 * Clocks the counter (half frame)
+	 */
+	void clock() {
+		if (!m_Halt && m_Counter > 0) {
+			m_Counter--;
+		}
+	}
+	/**
+	 * Checks if the channel is playing
+	 *
+	 * @return True if counter is not zero
+	 */
+	bool isActive() const {
+		return m_Counter > 0;
+	}
+};
+
+/**
+ * Basic channel with a timer
+ */
+class CChannel {
+protected:
+	/**
+	 * Timer period in CPU cycles
+	 */
+	int m_Period;
+	/**
+	 * CPU cycles left till the timer expires
+	 */
+	int m_Timer;
+
+	/**
+	 * Constructs the object
+	 *
+	 * @param period Timer period in CPU cycles
+	 */
+	explicit CChannel(int period) : m_Period(period), m_Timer(period - 1) {
+	}
+
+public:
+	/**
+	 * Clocks the timer
+	 *
+	 * @return True if the timer expired
+	 */
+	bool tick() {
+		if (m_Timer > 0) {
+			m_Timer--;
+			return false;
+		}
+		m_Timer = m_Period - 1;
+		return true;
+	}
+	/**
+	 * Skips timer cycles in closed form
+	 *
+	 * @param cycles Number of cycles
+	 * @return Number of expirations
+	 */
+	int skip(int cycles) {
+		if (cycles <= m_Timer) {
+			m_Timer -= cycles;
+			return 0;
+		}
+		cycles -= m_Timer + 1;
+		m_Timer = m_Period - 1 - cycles % m_Period;
+		return cycles / m_Period + 1;
+	}
+	/**
+	 * Gets CPU cycles till the timer expires
+	 *
+	 * @return Number of cycles
+	 */
+	int getDistance() const {
+		return m_Timer + 1;
+	}
+};
+
+/**
+ * Pulse channel
+ */
+class CPulse : public CChannel {
+private:
+	/**
+	 * Envelope
+	 */
+	CEnvelope m_Envelope;
+	/**
+	 * Length counter
+	 */
+	CLengthCounter m_Length;
+	/**
+	 * Sweep negates in ones' complement (first pulse channel)
+	 */
+	bool m_OnesComplement;
+	/**
+	 * Duty cycle
+	 */
+	std::uint8_t m_Duty;
+	/**
+	 * Sequencer step
+	 */
+	std::uint8_t m_Step;
+	/**
+	 * Period register
+	 */
+	int m_Raw;
+	/**
+	 * Sweep is enabled
+	 */
+	bool m_SweepEnabled;
+	/**
+	 * Sweep decreases the period
+	 */
+	bool m_SweepNegate;
+	/**
+	 * Reload sweep divider
+	 */
+	bool m_SweepReload;
+	/**
+	 * Sweep period
+	 */
+	std::uint8_t m_SweepPeriod;
+	/**
+	 * Sweep shift
+	 */
+	std::uint8_t m_SweepShift;
+	/**
+	 * Sweep divider
+	 */
+	std::uint8_t m_SweepDivider;
+
+	/**
+	 * Updates timer period from period register
+	 */
+	void updatePeriod() {
+		m_Period = (m_Raw + 1) * 2;
+	}
+	/**
+	 * Gets sweep target period
+	 *
+	 * @return Target period
+	 */
+	int getTarget() const {
+		int change = m_Raw >> m_SweepShift;
+		if (m_SweepNegate) {
+			return m_Raw - change - (m_OnesComplement ? 1 : 0);
+		}
+		return m_Raw + change;
+	}
+	/**
+	 * Checks if the sweep unit mutes the channel
+	 *
+	 * @return True if muted
+	 */
+	bool isMuted() const {
+		return m_Raw < 8 || getTarget() > 0x07ff;
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param onesComplement Sweep negates in ones' complement
+	 */
+	explicit CPulse(bool onesComplement)
+	    : CChannel(2)
+	    , m_Envelope()
+	    , m_Length()
+	    , m_OnesComplement(onesComplement)
+	    , m_Duty(0)
+	    , m_Step(0)
+	    , m_Raw(0)
+	    , m_SweepEnabled(false)
+	    , m_SweepNegate(false)
+	    , m_SweepReload(false)
+	    , m_SweepPeriod(0)
+	    , m_SweepShift(0)
+	    , m_SweepDivider(0) {
+	}
+
+	/**
+	 * Writes to register
+	 *
+	 * @param val Value
+	 * @param reg Register index
+	 */
+	void write(std::uint8_t val, std::uint16_t reg) {
+		switch (reg) {
+		case 0:
+			m_Duty = val >> 6;
+			m_Length.setHalt(val & 0x20);
+			m_Envelope.write(val);
+			break;
+		case 1:
+			m_SweepEnabled = val & 0x80;
+			m_SweepPeriod = (val >> 4) & 0x07;
+			m_SweepNegate = val & 0x08;
+			m_SweepShift = val & 0x07;
+			m_SweepReload = true;
+			break;
+		case 2:
+			m_Raw = (m_Raw & 0x0700) | val;
+			updatePeriod();
+			break;
+		case 3:
+			m_Raw = (m_Raw & 0x00ff) | ((val & 0x07) << 8);
+			updatePeriod();
+			m_Length.load(val);
+			m_Step = 0;
+			m_Envelope.restart();
+			break;
+		}
+	}
+	/**
+	 * Clocks the timer
+	 *
+	 * @return True if output may have changed
+	 */
+	bool tick() {
+		if (!CChannel::tick()) {
+			return false;
+		}
+		m_Step = (m_Step + 1) & 0x07;
+		return true;
+	}
+	/**
+	 * Skips timer cycles
+	 *
+	 * @param cycles Number of cycles
+	 */
+	void skip(int cycles) {
+		m_Step = (m_Step + CChannel::skip(cycles)) & 0x07;
+	}
+	/**
+	 * Checks if timer expirations change the output
+	 *
+	 * @return True if audible
+	 */
+	bool isAudible() const {
+		return m_Length.isActive() && !isMuted() && m_Envelope.getVolume() > 0;
+	}
+	/**
+	 * Clocks envelope (quarter frame)
+	 */
+	void clockQuarter() {
+		m_Envelope.clock();
+	}
+	/**
+	 * Clocks length counter and sweep (half frame)
+	 */
+	void clockHalf() {
+		m_Length.clock();
+		if (m_SweepDivider == 0 && m_SweepEnabled && m_SweepShift > 0 &&
+		    !isMuted()) {
+			m_Raw = getTarget();
+			updatePeriod();
+		}
+		if (m_SweepDivider == 0 || m_SweepReload) {
+			m_SweepDivider = m_SweepPeriod;
+			m_SweepReload = false;
+		} else {
+			m_SweepDivider--;
+		}
+	}
+	/**
+	 * Gets length counter
+	 *
+	 * @return Length counter
+	 */
+	CLengthCounter &getLength() {
+		return m_Length;
+	}
+	/**
+	 * Gets output level
+	 *
+	 * @return Level (0-15)
+	 */
+	std::uint8_t getOutput() const {
+		static const std::uint8_t duties[4] = {0x02, 0x06, 0x1e, 0xf9};
+		if (!m_Length.isActive() || isMuted() ||
+		    !(duties[m_Duty] & (0x80 >> m_Step))) {
+			return 0;
+		}
+		return m_Envelope.getVolume();
+	}
+};
+
+/**
+ * Triangle channel
+ */
+class CTriangle : public CChannel {
+private:
+	/**
+	 * Length counter
+	 */
+	CLengthCounter m_Length;
+	/**
+	 * Sequencer step
+	 */
+	std::uint8_t m_Step;
+	/**
+	 * Period register
+	 */
+	int m_Raw;
+	/**
+	 * Control flag (halts length and linear reload)
+	 */
+	bool m_Control;
+	/**
+	 * Reload linear counter
+	 */
+	bool m_LinearReload;
+	/**
+	 * Linear counter reload value
+	 */
+	std::uint8_t m_LinearPeriod;
+	/**
+	 * Linear counter
+	 */
+	std::uint8_t m_Linear;
+
+	/**
+	 * Checks if the sequencer is running
+	 *
+	 * @return True if running
+	 */
+	bool isRunning() const {
+		// Ultrasonic periods are silenced by holding the output
+		return m_Length.isActive() && m_Linear > 0 && m_Raw >= 2;
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CTriangle()
+	    : CChannel(1)
+	    , m_Length()
+	    , m_Step(0)
+	    , m_Raw(0)
+	    , m_Control(false)
+	    , m_LinearReload(false)
+	    , m_LinearPeriod(0)
+	    , m_Linear(0) {
+	}
+
+	/**
+	 * Writes to register
+	 *
+	 * @param val Value
+	 * @param reg Register index
+	 */
+	void write(std::uint8_t val, std::uint16_t reg) {
+		switch (reg) {
+		case 0:
+			m_Control = val & 0x80;
+			m_Length.setHalt(m_Control);
+			m_LinearPeriod = val & 0x7f;
+			break;
+		case 2:
+			m_Raw = (m_Raw & 0x0700) | val;
+			m_Period = m_Raw + 1;
+			break;
+		case 3:
+			m_Raw = (m_Raw & 0x00ff) | ((val & 0x07) << 8);
+			m_Period = m_Raw + 1;
+			m_Length.load(val);
+			m_LinearReload = true;
+			break;
+		}
+	}
+	/**
+	 * Clocks the timer
+	 *
+	 * @return True if output may have changed
+	 */
+	bool tick() {
+		if (!CChannel::tick() || !isRunning()) {
+			return false;
+		}
+		m_Step = (m_Step + 1) & 0x1f;
+		return true;
+	}
+	/**
+	 * Skips timer cycles
+	 *
+	 * @param cycles Number of cycles
+	 */
+	void skip(int cycles) {
+		int count = CChannel::skip(cycles);
+		if (isRunning()) {
+			m_Step = (m_Step + count) & 0x1f;
+		}
+	}
+	/**
+	 * Checks if timer expirations change the output
+	 *
+	 * @return True if audible
+	 */
+	bool isAudible() const {
+		return isRunning();
+	}
+	/**
+	 * Clocks linear counter (quarter frame)
+	 */
+	void clockQuarter() {
+		if (m_LinearReload) {
+			m_Linear = m_LinearPeriod;
+		} else if (m_Linear > 0) {
+			m_Linear--;
+		}
+		if (!m_Control) {
+			m_LinearReload = false;
+		}
+	}
+	/**
+	 * Clocks length counter (half frame)
+	 */
+	void clockHalf() {
+		m_Length.clock();
+	}
+	/**
+	 * Gets length counter
+	 *
+	 * @return Length counter
+	 */
+	CLengthCounter &getLength() {
+		return m_Length;
+	}
+	/**
+	 * Gets output level
+	 *
+	 * @return Level (0-15)
+	 */
+	std::uint8_t getOutput() const {
+		return (m_Step < 0x10) ? 0x0f - m_Step : m_Step - 0x10;
+	}
+};
+
+/**
+ * Noise channel
+ */
+class CNoise : public CChannel {
+private:
+	/**
+	 * Envelope
+	 */
+	CEnvelope m_Envelope;
+	/**
+	 * Length counter
+	 */
+	CLengthCounter m_Length;
+	/**
+	 * Short sequence mode
+	 */
+	bool m_Mode;
+	/**
+	 * Shift register
+	 */
+	std::uint16_t m_Shift;
+
+	/**
+	 * Clocks shift register
+	 */
+	void shift() {
+		std::uint16_t feedback =
+		    (m_Shift ^ (m_Shift >> (m_Mode ? 6 : 1))) & 0x01;
+		m_Shift = (m_Shift >> 1) | (feedback << 14);
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CNoise()
+	    : CChannel(4), m_Envelope(), m_Length(), m_Mode(false), m_Shift(1) {
+	}
+
+	/**
+	 * Writes to register
+	 *
+	 * @param val Value
+	 * @param reg Register index
+	 */
+	void write(std::uint8_t val, std::uint16_t reg) {
+		static const int periods[0x10] = {4, 8, 16, 32, 64, 96, 128, 160,
+		    202, 254, 380, 508, 762, 1016, 2034, 4068};
+		switch (reg) {
+		case 0:
+			m_Length.setHalt(val & 0x20);
+			m_Envelope.write(val);
+			break;
+		case 2:
+			m_Mode = val & 0x80;
+			m_Period = periods[val & 0x0f];
+			break;
+		case 3:
+			m_Length.load(val);
+			m_Envelope.restart();
+			break;
+		}
+	}
+	/**
+	 * Clocks the timer
+	 *
+	 * @return True if output may have changed
+	 */
+	bool tick() {
+		if (!CChannel::tick()) {
+			return false;
+		}
+		shift();
+		return true;
+	}
+	/**
+	 * Skips timer cycles
+	 *
+	 * @param cycles Number of cycles
+	 */
+	void skip(int cycles) {
+		for (int count = CChannel::skip(cycles); count > 0; count--) {
+			shift();
+		}
+	}
+	/**
+	 * Checks if timer expirations change the output
+	 *
+	 * @return True if audible
+	 */
+	bool isAudible() const {
+		return m_Length.isActive() && m_Envelope.getVolume() > 0;
+	}
+	/**
+	 * Clocks envelope (quarter frame)
+	 */
+	void clockQuarter() {
+		m_Envelope.clock();
+	}
+	/**
+	 * Clocks length counter (half frame)
+	 */
+	void clockHalf() {
+		m_Length.clock();
+	}
+	/**
+	 * Gets length counter
+	 *
+	 * @return Length counter
+	 */
+	CLengthCounter &getLength() {
+		return m_Length;
+	}
+	/**
+	 * Gets output level
+	 *
+	 * @return Level (0-15)
+	 */
+	std::uint8_t getOutput() const {
+		if (!m_Length.isActive() || (m_Shift & 0x01)) {
+			return 0;
+		}
+		return m_Envelope.getVolume();
+	}
+};
+
+/**
+ * Delta modulation channel
+ */
+class CDMC : public CChannel {
+private:
+	/**
+	 * Generate IRQ at sample end
+	 */
+	bool m_IRQEnabled;
+	/**
+	 * IRQ flag
+	 */
+	bool m_IRQ;
+	/**
+	 * Loop sample
+	 */
+	bool m_Loop;
+	/**
+	 * Output level
+	 */
+	std::uint8_t m_Output;
+	/**
+	 * Sample address register
+	 */
+	std::uint16_t m_SampleAddr;
+	/**
+	 * Sample length register
+	 */
+	std::uint16_t m_SampleLength;
+	/**
+	 * Address of the next sample byte
+	 */
+	std::uint16_t m_Addr;
+	/**
+	 * Bytes left to fetch
+	 */
+	std::uint16_t m_BytesLeft;
+	/**
+	 * Fetched sample byte
+	 */
+	std::uint8_t m_Buffer;
+	/**
+	 * Sample byte is fetched
+	 */
+	bool m_BufferFull;
+	/**
+	 * Output shift register
+	 */
+	std::uint8_t m_Shift;
+	/**
+	 * Bits left in output cycle
+	 */
+	std::uint8_t m_BitsLeft;
+	/**
+	 * Output is silenced
+	 */
+	bool m_Silence;
+
+	/**
+	 * Restarts the sample
+	 */
+	void restart() {
+		m_Addr = m_SampleAddr;
+		m_BytesLeft = m_SampleLength;
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CDMC()
+	    : CChannel(428)
+	    , m_IRQEnabled(false)
+	    , m_IRQ(false)
+	    , m_Loop(false)
+	    , m_Output(0)
+	    , m_SampleAddr(0xc000)
+	    , m_SampleLength(1)
+	    , m_Addr(0xc000)
+	    , m_BytesLeft(0)
+	    , m_Buffer(0)
+	    , m_BufferFull(false)
+	    , m_Shift(0)
+	    , m_BitsLeft(8)
+	    , m_Silence(true) {
+	}
+
+	/**
+	 * Writes to register
+	 *
+	 * @param val Value
+	 * @param reg Register index
+	 */
+	void write(std::uint8_t val, std::uint16_t reg) {
+		static const int periods[0x10] = {428, 380, 340, 320, 286, 254, 226,
+		    214, 190, 160, 142, 128, 106, 84, 72, 54};
+		switch (reg) {
+		case 0:
+			m_IRQEnabled = val & 0x80;
+			if (!m_IRQEnabled) {
+				m_IRQ = false;
+			}
+			m_Loop = val & 0x40;
+			m_Period = periods[val & 0x0f];
+			break;
+		case 1:
+			m_Output = val & 0x7f;
+			break;
+		case 2:
+			m_SampleAddr = 0xc000 | (val << 6);
+			break;
+		case 3:
+			m_SampleLength = (val << 4) | 0x0001;
+			break;
+		}
+	}
+	/**
+	 * Enables or disables the channel
+	 *
+	 * @param enabled True to enable
+	 */
+	void setEnabled(bool enabled) {
+		m_IRQ = false;
+		if (!enabled) {
+			m_BytesLeft = 0;
+		} else if (m_BytesLeft == 0) {
+			restart();
+		}
+	}
+	/**
+	 * Clocks the timer
+	 *
+	 * @return True if output may have changed
+	 */
+	bool tick() {
+		if (!CChannel::tick()) {
+			return false;
+		}
+		if (!m_Silence) {
+			if (m_Shift & 0x01) {
+				if (m_Output <= 125) {
+					m_Output += 2;
+				}
+			} else if (m_Output >= 2) {
+				m_Output -= 2;
+			}
+		}
+		m_Shift >>= 1;
+		if (--m_BitsLeft == 0) {
+			m_BitsLeft = 8;
+			m_Silence = !m_BufferFull;
+			m_Shift = m_Buffer;
+			m_BufferFull = false;
+		}
+		return true;
+	}
+	/**
+	 * Skips timer cycles (expirations are only skipped while idle)
+	 *
+	 * @param cycles Number of cycles
+	 */
+	void skip(int cycles) {
+		int count = CChannel::skip(cycles);
+		if (count > 0) {
+			m_BitsLeft = (m_BitsLeft + 7 - count % 8) % 8 + 1;
+			m_Shift = 0;
+		}
+	}
+	/**
+	 * Checks if the channel neither plays nor fetches
+	 *
+	 * @return True if idle
+	 */
+	bool isIdle() const {
+		return m_Silence && !m_BufferFull && m_BytesLeft == 0;
+	}
+	/**
+	 * Gets CPU cycles till the next sample fetch
+	 *
+	 * @return Number of cycles, 0 if fetch is pending or -1 if none
+	 */
+	int getFetchDistance() const {
+		if (m_BytesLeft == 0) {
+			return -1;
+		}
+		if (!m_BufferFull) {
+			return 0;
+		}
+		return getDistance() + (m_BitsLeft - 1) * m_Period;
+	}
+	/**
+	 * Checks if a sample byte should be fetched
+	 *
+	 * @return True if fetch is needed
+	 */
+	bool isFetchNeeded() const {
+		return !m_BufferFull && m_BytesLeft > 0;
+	}
+	/**
+	 * Gets address of the next sample byte
+	 *
+	 * @return Address
+	 */
+	std::uint16_t getAddress() const {
+		return m_Addr;
+	}
+	/**
+	 * Loads fetched sample byte
+	 *
+	 * @param val Sample byte
+	 */
+	void load(std::uint8_t val) {
+		m_Buffer = val;
+		m_BufferFull = true;
+		m_Addr = (m_Addr == 0xffff) ? 0x8000 : m_Addr + 1;
+		if (--m_BytesLeft == 0) {
+			if (m_Loop) {
+				restart();
+			} else if (m_IRQEnabled) {
+				m_IRQ = true;
+			}
+		}
+	}
+	/**
+	 * Checks if the sample is playing
+	 *
+	 * @return True if bytes are left
+	 */
+	bool isActive() const {
+		return m_BytesLeft > 0;
+	}
+	/**
+	 * Checks IRQ flag
+	 *
+	 * @return True if IRQ is requested
+	 */
+	bool isIRQ() const {
+		return m_IRQ;
+	}
+	/**
+	 * Gets output level
+	 *
+	 * @return Level (0-127)
+	 */
+	std::uint8_t getOutput() const {
+		return m_Output;
+	}
+};
+
+}  // namespace apu
+
+}  // namespace core
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_CORE_APU_CHANNELS_HPP_
@@ -0,0 +1,230 @@
+/**
+ * @file
+ *
+ * Defines band-limited step buffer
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_CORE_BLIP_HPP_
+#define INCLUDE_VPNES_CORE_BLIP_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/device.hpp>
+
+#ifdef VPNES_AVX2
+#include <immintrin.h>
+#elif defined(VPNES_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace vpnes {
+
+namespace core {
+
+/**
+ * Band-limited step buffer
+ *
+ * Sources add amplitude steps at clock times. Each step is spread over a
+ * few output samples by a windowed sinc kernel, and the samples are
+ * obtained by integrating the buffer at the end of a block. The cost is
+ * proportional to the number of steps, not to the clock rate. Kernels are
+ * stored per phase, so a step costs one vectorized multiply-add over the
+ * taps.
+ */
+class CBlipBuffer {
+public:
+	/**
+	 * Implementations of step addition (all give the same output)
+	 */
+	enum EMixer {
+		MixerScalar,  //!< Plain loop
+		MixerSSE2,    //!< 16-bit products interleaved into 32-bit sums
+		MixerAVX2,    //!< Weights widened to 32 bits
+#if defined(VPNES_AVX2)
+		MixerDefault = MixerAVX2  //!< Fastest one enabled
+#elif defined(VPNES_SSE2)
+		MixerDefault = MixerSSE2  //!< Fastest one enabled
+#else
+		MixerDefault = MixerScalar  //!< Fastest one enabled
+#endif
+	};
+
+private:
+	/**
+	 * Kernel parameters
+	 */
+	enum {
+		Taps = 16,                  //!< Samples affected by a step
+		PhaseBits = 5,              //!< Bits of sub-sample position
+		Phases = 1 << PhaseBits,    //!< Kernels for sub-sample positions
+		UnityBits = 15,             //!< Fixed-point shift of kernel
+		HighPassShift = 9,          //!< DC removal strength
+		FractionBits = 32           //!< Fixed-point shift of positions
+	};
+
+	/**
+	 * Clock period in ms
+	 */
+	double m_Frequency;
+	/**
+	 * Longest block in ticks
+	 */
+	ticks_t m_BlockTime;
+	/**
+	 * Samples per tick in fixed-point
+	 */
+	std::uint64_t m_Factor;
+	/**
+	 * Position of block start in fixed-point samples
+	 */
+	std::uint64_t m_Offset;
+	/**
+	 * Step kernels for each phase
+	 */
+	std::int16_t m_Kernel[Phases][Taps];
+	/**
+	 * Accumulated steps
+	 */
+	std::vector<std::int32_t> m_Buffer;
+	/**
+	 * Output samples of the last block
+	 */
+	std::vector<std::int16_t> m_Samples;
+	/**
+	 * Integrated amplitude
+	 */
+	std::int32_t m_Integrator;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CBlipBuffer() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param frequency Clock period in ms
+	 * @param blockTime Longest block in ticks
+	 */
+	CBlipBuffer(double frequency, ticks_t blockTime);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CBlipBuffer(const CBlipBuffer &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CBlipBuffer() = default;
+
+	/**
+	 * Sets output sample rate
+	 *
+	 * @param rate Sample rate in Hz
+	 */
+	void setSampleRate(double rate);
+	/**
+	 * Adds amplitude step
+	 *
+	 * @param time Time since block start
+	 * @param delta Amplitude change (fits 16 bits)
+	 */
+	template <EMixer Mixer = MixerDefault>
+	void addDelta(ticks_t time, int delta) {
+		std::uint64_t position =
+		    m_Offset + static_cast<std::uint64_t>(time) * m_Factor;
+		std::int32_t *buffer = &m_Buffer[position >> FractionBits];
+		const std::int16_t *kernel =
+		    m_Kernel[(position >> (FractionBits - PhaseBits)) & (Phases - 1)];
+		if constexpr (Mixer == MixerAVX2) {
+#ifdef VPNES_AVX2
+			__m256i factor = _mm256_set1_epi32(delta);
+			for (std::size_t tap = 0; tap < Taps; tap += 8) {
+				__m256i weights = _mm256_cvtepi16_epi32(_mm_loadu_si128(
+				    reinterpret_cast<const __m128i *>(kernel + tap)));
+				__m256i *output = reinterpret_cast<__m256i *>(buffer + tap);
+				_mm256_storeu_si256(output,
+				    _mm256_add_epi32(_mm256_loadu_si256(output),
+				        _mm256_mullo_epi32(weights, factor)));
+			}
+#else
+			static_assert(Mixer != MixerAVX2, "AVX2 is not enabled");
+#endif
+		} else if constexpr (Mixer == MixerSSE2) {
+#ifdef VPNES_SSE2
+			// Products are exact only while the delta fits 16 bits
+			assert(delta >= INT16_MIN && delta <= INT16_MAX);
+			// 16-bit halves of the products are interleaved into 32-bit ones
+			__m128i factor = _mm_set1_epi16(static_cast<std::int16_t>(delta));
+			for (std::size_t tap = 0; tap < Taps; tap += 8) {
+				__m128i weights = _mm_loadu_si128(
+				    reinterpret_cast<const __m128i *>(kernel + tap));
+				__m128i low = _mm_mullo_epi16(weights, factor);
+				__m128i high = _mm_mulhi_epi16(weights, factor);
+				__m128i *output = reinterpret_cast<__m128i *>(buffer + tap);
+				_mm_storeu_si128(output,
+				    _mm_add_epi32(_mm_loadu_si128(output),
+				        _mm_unpacklo_epi16(low, high)));
+				_mm_storeu_si128(output + 1,
+				    _mm_add_epi32(_mm_loadu_si128(output + 1),
+				        _mm_unpackhi_epi16(low, high)));
+			}
+#else
+			static_assert(Mixer != MixerSSE2, "SSE2 is not enabled");
+#endif
+		} else {
+			for (std::size_t tap = 0; tap < Taps; tap++) {
+				buffer[tap] += kernel[tap] * delta;
+			}
+		}
+	}
+	/**
+	 * Ends block and produces samples
+	 *
+	 * @param time Block length in ticks
+	 * @return Number of samples
+	 */
+	std::size_t endBlock(ticks_t time);
+	/**
+	 * Gets samples of the last block
+	 *
+	 * @return Samples
+	 */
+	const std::int16_t *getSamples() const {
+		return m_Samples.data();
+	}
+};
+
+}  // namespace core
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_CORE_BLIP_HPP_
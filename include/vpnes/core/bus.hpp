@@ -270,6 +270,10 @@ protected:
 	 * Dummy write buffer
 	 */
 	std::uint8_t m_DummyWrite;
+	/**
+	 * Pages with read hooks
+	 */
+	bool m_ReadHookPages[0x100];
 
 	/**
 	 * Executes all pre read hooks for an address
@@ -322,7 +326,8 @@ protected:
 	    , m_WriteHooks()
 	    , m_OpenBus(openBus)
 	    , m_WriteBuf()
-	    , m_DummyWrite() {
+	    , m_DummyWrite()
+	    , m_ReadHookPages() {
 	}
 	/**
 	 * Deleted copy constructor
@@ -355,6 +360,23 @@ public:
 	 */
 	virtual void writeMemory(
 	    std::uint8_t s, std::uint16_t addr, bool direct = false) = 0;
+	/**
+	 * Gets memory of the page for bulk reads
+	 *
+	 * @param page Page number
+	 * @return Page memory or nullptr if the page has to be read byte by byte
+	 */
+	virtual const std::uint8_t *getPage(std::uint8_t page) = 0;
+	/**
+	 * Gets memory of the page for direct bulk writes
+	 *
+	 * Write hooks are not executed, as with direct writes.
+	 *
+	 * @param page Page number
+	 * @return Page memory or nullptr if the page has to be written byte by
+	 * byte
+	 */
+	virtual std::uint8_t *getWritePage(std::uint8_t page) = 0;
 
 	/**
 	 * Adds new pre read hook
@@ -368,6 +390,7 @@ public:
 	    typename CAddrHookMapped<T>::addrHook_t hook) {
 		m_ReadHooksPre.emplace(
 		    addr, std::make_unique<CAddrHookMapped<T>>(device, hook));
+		m_ReadHookPages[addr >> 8] = true;
 	}
 	/**
 	 * Adds new post read hook
@@ -381,6 +404,7 @@ public:
 	    typename CAddrValHookMapped<T>::addrHook_t hook) {
 		m_ReadHooksPost.emplace(
 		    addr, std::make_unique<CAddrValHookMapped<T>>(device, hook));
+		m_ReadHookPages[addr >> 8] = true;
 	}
 	/**
 	 * Adds new write hook
@@ -1220,6 +1244,24 @@ private:
 	BankConfig();
 };
 
+/**
+ * Exact bus conflicts (write hooks are repeated until the value settles)
+ */
+struct ConflictExact {
+	enum {
+		Cycled = true  //!< Repeat write hooks
+	};
+};
+
+/**
+ * Relaxed bus conflicts (value is resolved once)
+ */
+struct ConflictRelaxed {
+	enum {
+		Cycled = false  //!< Repeat write hooks
+	};
+};
+
 }  // namespace banks
 
 /**
@@ -1508,14 +1550,14 @@ struct COpenBusDevice : CDevice {
 /**
  * Configured bus
  */
-template <class...>
+template <class BusConflict, class...>
 class CBusConfig;
 
 /**
  * Empty bus
  */
-template <>
-class CBusConfig<> : public CBus {
+template <class BusConflict>
+class CBusConfig<BusConflict> : public CBus {
 public:
 	/**
 	 * Constructor
@@ -1546,12 +1588,30 @@ public:
 	 */
 	void writeMemory(std::uint8_t s, std::uint16_t addr) {
 	}
+	/**
+	 * Gets memory of the page for bulk reads
+	 *
+	 * @param page Page number
+	 * @return nullptr (no memory on the bus)
+	 */
+	const std::uint8_t *getPage(std::uint8_t page) {
+		return nullptr;
+	}
+	/**
+	 * Gets memory of the page for direct bulk writes
+	 *
+	 * @param page Page number
+	 * @return nullptr (no memory on the bus)
+	 */
+	std::uint8_t *getWritePage(std::uint8_t page) {
+		return nullptr;
+	}
 };
 
 /**
  * Configured bus
  */
-template <class... DeviceConfigs>
+template <class BusConflict, class... DeviceConfigs>
 class CBusConfig : public CBus {
 private:
 	static_assert(
@@ -1633,6 +1693,55 @@ public:
 		}
 		return res;
 	}
+	/**
+	 * Gets memory of the page for bulk reads
+	 *
+	 * The page is linear when its first and last bytes are 255 bytes apart.
+	 * Banks smaller than a page are device registers, which have hooks.
+	 *
+	 * @param page Page number
+	 * @return Page memory or nullptr if the page has to be read byte by byte
+	 */
+	const std::uint8_t *getPage(std::uint8_t page) {
+		if (m_ReadHookPages[page]) {
+			return nullptr;
+		}
+		std::uint16_t addr = page << 8;
+		const std::uint8_t *first = *BusAggregate<DeviceConfigs...,
+		    COpenBusDevice::BusConfig>::getAddrRead(m_DeviceArr.begin(),
+		    m_ReadArr.begin(), addr);
+		const std::uint8_t *last = *BusAggregate<DeviceConfigs...,
+		    COpenBusDevice::BusConfig>::getAddrRead(m_DeviceArr.begin(),
+		    m_ReadArr.begin(), addr | 0xff);
+		if (last - first != 0xff) {
+			return nullptr;
+		}
+		return first;
+	}
+	/**
+	 * Gets memory of the page for direct bulk writes
+	 *
+	 * The page is linear when its first and last bytes are 255 bytes apart.
+	 * Pages with bus conflicts are written byte by byte.
+	 *
+	 * @param page Page number
+	 * @return Page memory or nullptr if the page has to be written byte by
+	 * byte
+	 */
+	std::uint8_t *getWritePage(std::uint8_t page) {
+		std::uint16_t addr = page << 8;
+		auto first = BusAggregate<DeviceConfigs...,
+		    COpenBusDevice::BusConfig>::getAddrWrite(m_DeviceArr.begin(),
+		    m_WriteArr.begin(), m_ModArr.begin(), addr);
+		auto last = BusAggregate<DeviceConfigs...,
+		    COpenBusDevice::BusConfig>::getAddrWrite(m_DeviceArr.begin(),
+		    m_WriteArr.begin(), m_ModArr.begin(), addr | 0xff);
+		if (*last.first - *first.first != 0xff ||
+		    *first.second != &m_WriteBuf || *last.second != &m_WriteBuf) {
+			return nullptr;
+		}
+		return *first.first;
+	}
 	/**
 	 * Writes memory on the bus
 	 *
@@ -1644,25 +1753,25 @@ public:
 		auto iter = BusAggregate<DeviceConfigs...,
 		    COpenBusDevice::BusConfig>::getAddrWrite(m_DeviceArr.begin(),
 		    m_WriteArr.begin(), m_ModArr.begin(), addr);
-#if defined(VPNES_BUSCONFLICT_CYCLED)
-		m_WriteBuf = s;
-		std::uint8_t val = m_WriteBuf & **(iter.second);
-		do {
-			m_WriteBuf = val;
+		if (BusConflict::Cycled) {
+			m_WriteBuf = s;
+			std::uint8_t val = m_WriteBuf & **(iter.second);
+			do {
+				m_WriteBuf = val;
+				if (!direct) {
+					processWriteHooks(m_WriteBuf, addr);
+				}
+				val &= **(iter.second);
+			} while (val != m_WriteBuf);
+			**(iter.first) = m_WriteBuf;
+		} else {
+			m_WriteBuf = s;
+			m_WriteBuf &= **(iter.second);
 			if (!direct) {
 				processWriteHooks(m_WriteBuf, addr);
 			}
-			val &= **(iter.second);
-		} while (val != m_WriteBuf);
-		**(iter.first) = m_WriteBuf;
-#else
-		m_WriteBuf = s;
-		m_WriteBuf &= **(iter.second);
-		if (!direct) {
-			processWriteHooks(m_WriteBuf, addr);
+			**(iter.first) = m_WriteBuf;
 		}
-		**(iter.first) = m_WriteBuf;
-#endif
 	}
 };
 
@@ -32,10 +32,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
-#include <fstream>
+#include <string>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/frontend.hpp>
+#include <vpnes/core/image.hpp>
 #include <vpnes/core/nes.hpp>
 #include <vpnes/gui/config.hpp>
 
@@ -78,13 +80,17 @@ enum EMMCType {
  */
 struct SNESConfig {
 	/**
-	 * CHR ROM
+	 * Mapped ROM file shared with other instances
 	 */
-	std::vector<std::uint8_t> CHR;
+	std::shared_ptr<const CROMImage> Image;
 	/**
-	 * PRG ROM
+	 * CHR ROM (points into the image, nullptr if absent)
 	 */
-	std::vector<std::uint8_t> PRG;
+	const std::uint8_t *CHR;
+	/**
+	 * PRG ROM (points into the image)
+	 */
+	const std::uint8_t *PRG;
 	/**
 	 * Trainer hack
 	 */
@@ -113,15 +119,17 @@ struct SNESConfig {
 	 * NES Type
 	 */
 	ENESType NESType;
+	/**
+	 * Accuracy/performance profile
+	 */
+	std::string Profile;
 
 	/**
 	 * Configures the class
 	 *
 	 * @param appConfig Application configuration
-	 * @param inputFile Input file stream
 	 */
-	void configure(
-	    const gui::SApplicationConfig &appConfig, std::ifstream *inputFile);
+	void configure(const gui::SApplicationConfig &appConfig);
 	/**
 	 * Creates an instance of NES
 	 *
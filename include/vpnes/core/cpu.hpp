@@ -41,6 +41,28 @@ namespace vpnes {
 
 namespace core {
 
+namespace cpu {
+
+/**
+ * Cycle-stepped execution (CPU can stop on any bus cycle)
+ */
+struct CycleStep {
+	enum {
+		CheckEachCycle = true  //!< Check the clock on each bus access
+	};
+};
+
+/**
+ * Instruction-stepped execution (CPU stops on instruction boundaries only)
+ */
+struct InstructionStep {
+	enum {
+		CheckEachCycle = false  //!< Check the clock on each bus access
+	};
+};
+
+}  // namespace cpu
+
 /**
  * Basic CPU
  */
@@ -94,6 +116,13 @@ public:
 			return 0;
 		}
 	};
+	/**
+	 * IRQ sources
+	 */
+	enum EIRQSource {
+		IRQSourceFrame = 0x01,  //!< APU frame counter
+		IRQSourceDMC = 0x02     //!< APU delta modulation channel
+	};
 	/**
 	 * Bus mode
 	 */
@@ -107,14 +136,28 @@ private:
 	 * Internal opcodes implementation
 	 */
 	struct opcodes;
+	/**
+	 * Execution routine
+	 *
+	 * @param cpu CPU
+	 */
+	typedef void (*executor_t)(CCPU *cpu);
 	/**
 	 * Motherboard
 	 */
 	CMotherBoard *m_MotherBoard;
+	/**
+	 * Execution routine for selected stepping
+	 */
+	executor_t m_Executor;
 	/**
 	 * Internal clock
 	 */
 	ticks_t m_InternalClock;
+	/**
+	 * Ticks removed by clock resets modulo two cycles
+	 */
+	ticks_t m_ClockOffset;
 	/**
 	 * Current index in compiled microcode
 	 */
@@ -124,9 +167,9 @@ private:
 	 */
 	std::uint8_t m_RAM[0x0800];
 	/**
-	 * Pending IRQ
+	 * Pending IRQ (active sources)
 	 */
-	bool m_PendingIRQ;
+	int m_PendingIRQ;
 	/**
 	 * Pending NMI
 	 */
@@ -314,8 +357,22 @@ private:
 	 * Processes interrupts
 	 */
 	void processInterrupts() {
-		// TODO(me) : Update interrupt flags
+		m_PendingINT = m_PendingNMI || (m_PendingIRQ && !m_Interrupt);
 	}
+	/**
+	 * Executes microcode till reaching current clock value
+	 *
+	 * @param cpu CPU
+	 */
+	template <class StepMode>
+	static void executeStep(CCPU *cpu);
+	/**
+	 * Constructs the object
+	 *
+	 * @param motherBoard Motherboard
+	 * @param executor Execution routine
+	 */
+	CCPU(CMotherBoard *motherBoard, executor_t executor);
 
 protected:
 	/**
@@ -328,7 +385,9 @@ protected:
 	 * @param ticks Amount of ticks
 	 */
 	void resetClock(ticks_t ticks) {
+		CClockedDevice::resetClock(ticks);
 		m_InternalClock -= ticks;
+		m_ClockOffset = (m_ClockOffset + ticks) % 24;
 	}
 
 public:
@@ -340,8 +399,12 @@ public:
 	 * Constructs the object
 	 *
 	 * @param motherBoard Motherboard
+	 * @param stepMode Execution stepping
 	 */
-	explicit CCPU(CMotherBoard *motherBoard);
+	template <class StepMode>
+	CCPU(CMotherBoard *motherBoard, StepMode stepMode)
+	    : CCPU(motherBoard, &executeStep<StepMode>) {
+	}
 	/**
 	 * Destroys the object
 	 */
@@ -354,6 +417,50 @@ public:
 	 */
 	void addHooksCPU(CBus *bus) {
 	}
+	/**
+	 * Triggers non-maskable interrupt
+	 */
+	void triggerNMI() {
+		m_PendingNMI = true;
+	}
+	/**
+	 * Sets IRQ line of a source
+	 *
+	 * @param source Source
+	 * @param active True if the source requests IRQ
+	 */
+	void setIRQ(EIRQSource source, bool active) {
+		if (active) {
+			m_PendingIRQ |= source;
+		} else {
+			m_PendingIRQ &= ~source;
+		}
+	}
+	/**
+	 * Halts the CPU for sprite DMA
+	 *
+	 * Called on the write cycle to $4014. The transfer takes 513 cycles
+	 * and one more to align when the write is on an odd cycle.
+	 */
+	void haltDMA() {
+		ticks_t cycle = (m_InternalClock + m_ClockOffset) / 12;
+		m_InternalClock += (513 + (cycle & 1)) * 12;
+	}
+	/**
+	 * Halts the CPU for a DMC sample fetch
+	 *
+	 * The fetch steals 4 cycles. The APU fetches only after the CPU has
+	 * passed the fetch time, so the CPU is stopped at the instruction
+	 * boundary it has reached.
+	 *
+	 * Hardware stalls for 1 to 4 cycles: 3 if the halt lands on a write
+	 * cycle and fewer if it overlaps OAM DMA. The alignment is not modeled,
+	 * so code timed against writes or OAM DMA sees up to 3 extra cycles
+	 * per fetch.
+	 */
+	void haltDMC() {
+		m_InternalClock += 4 * 12;
+	}
 
 	/**
 	 * Gets pending time
@@ -365,6 +472,9 @@ public:
 	}
 };
 
+extern template void CCPU::executeStep<cpu::CycleStep>(CCPU *cpu);
+extern template void CCPU::executeStep<cpu::InstructionStep>(CCPU *cpu);
+
 }  // namespace core
 
 }  // namespace vpnes
@@ -29,7 +29,11 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <cstdint>
+#include <array>
 #include <utility>
+#include <type_traits>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/cpu.hpp>
 
@@ -140,35 +144,6 @@ struct Operation<FirstCycle, OtherCycles...> {
 	}
 };
 
-/**
- * Expands pack to operation offset
- */
-template <class OperationPack>
-struct OperationOffsetExpand {
-	template <class Operation>
-	struct type {
-		enum { offset = 0 };
-	};
-};
-
-/**
- * Implementation of expansion to operation offset
- */
-template <class FirstOperation, class... OtherOperations>
-struct OperationOffsetExpand<class_pack<FirstOperation, OtherOperations...>> {
-	template <class Operation>
-	struct type {
-		enum {
-			offset = std::is_same<Operation, FirstOperation>::value
-			             ? 0
-			             : FirstOperation::Size +
-			                   OperationOffsetExpand<
-			                       class_pack<OtherOperations...>>::
-			                       template type<Operation>::offset
-		};
-	};
-};
-
 /**
  * Invokes operation
  */
@@ -181,64 +156,150 @@ struct Invoker {
 };
 
 /**
- * Clones invoker with parameters needed
- */
-template <std::size_t Index, class Operation, class IndexPack>
-struct InvokeExpandHelper;
-
-/**
- * Clones invoker with parameters needed
+ * Computes placement of operations in compiled microcode
  */
+template <class... Operations>
+struct OperationLayoutBuilder {
+	enum {
+		Count = sizeof...(Operations)  //!< Amount of operations
+	};
 
-template <std::size_t Index, class Operation, std::size_t... Indices>
-struct InvokeExpandHelper<Index, Operation, std::index_sequence<Indices...>>
-    : class_pack<Invoker<Indices, Index + Indices, Operation>...> {};
+	/**
+	 * Looks up first occurrence of operation
+	 *
+	 * @return Index in operation list
+	 */
+	template <class Operation>
+	static constexpr std::size_t find() {
+		std::size_t index = 0;
+		std::size_t result = Count;
+		((result = (result == Count && std::is_same_v<Operation, Operations>)
+		               ? index
+		               : result,
+		     ++index),
+		    ...);
+		return result;
+	}
+	/**
+	 * Computes offsets of operations
+	 *
+	 * Duplicate operations share offset with their first occurrence
+	 *
+	 * @return Array of offsets
+	 */
+	static constexpr std::array<std::size_t, Count> makeOffsets() {
+		constexpr std::size_t sizes[Count] = {Operations::Size...};
+		constexpr std::size_t first[Count] = {find<Operations>()...};
+		std::array<std::size_t, Count> offsets{};
+		std::size_t offset = 0;
+		for (std::size_t i = 0; i < Count; i++) {
+			if (first[i] == i) {
+				offsets[i] = offset;
+				offset += sizes[i];
+			} else {
+				offsets[i] = offsets[first[i]];
+			}
+		}
+		return offsets;
+	}
+	/**
+	 * Computes size of compiled microcode
+	 *
+	 * @return Size of compiled microcode
+	 */
+	static constexpr std::size_t makeSize() {
+		constexpr std::size_t sizes[Count] = {Operations::Size...};
+		constexpr std::size_t first[Count] = {find<Operations>()...};
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < Count; i++) {
+			if (first[i] == i) {
+				size += sizes[i];
+			}
+		}
+		return size;
+	}
+};
 
 /**
- * Expands invoke
+ * Compiled microcode for the list of operations
  */
-template <std::size_t Offset, class CurrentPack>
-struct InvokeExpand;
+template <class... Operations>
+struct OperationLayout : OperationLayoutBuilder<Operations...> {
+	/**
+	 * Actual type
+	 */
+	using type = OperationLayout;
+	/**
+	 * Layout builder
+	 */
+	using builder = OperationLayoutBuilder<Operations...>;
+	enum {
+		Size = builder::makeSize()  //!< Size of compiled microcode
+	};
+	/**
+	 * Offsets of operations
+	 */
+	static constexpr std::array<std::size_t, sizeof...(Operations)> offsets =
+	    builder::makeOffsets();
 
-/**
- * Empty invoke
- */
-template <std::size_t Offset>
-struct InvokeExpand<Offset, class_pack<>> : class_pack<> {};
+	/**
+	 * Gets operation offset
+	 *
+	 * @return Offset in compiled microcode
+	 */
+	template <class Operation>
+	static constexpr std::size_t getOffset() {
+		return offsets[builder::template find<Operation>()];
+	}
 
-/**
- * Implementation of invoke expansion
- */
-template <std::size_t Offset, class FirstOperation, class... OtherOperations>
-struct InvokeExpand<Offset, class_pack<FirstOperation, OtherOperations...>>
-    : merge_class_pack<
-          typename InvokeExpandHelper<Offset, FirstOperation,
-              std::make_index_sequence<FirstOperation::Size>>::type,
-          typename InvokeExpand<Offset + FirstOperation::Size,
-              class_pack<OtherOperations...>>::type> {};
+private:
+	/**
+	 * Microcode handler
+	 */
+	typedef void (*handler_t)(CCPU *);
+	/**
+	 * Microcode handlers
+	 */
+	typedef std::array<handler_t, Size> handlers_t;
 
-/**
- * Invokes operation by index
- */
-template <class OperationPack>
-struct Invoke;
+	/**
+	 * Puts operation handlers into compiled microcode
+	 *
+	 * @param handlers Compiled microcode
+	 */
+	template <class Control, class Operation, std::size_t Base,
+	    std::size_t... Offsets>
+	static constexpr void fillHandlers(
+	    handlers_t *handlers, std::index_sequence<Offsets...>) {
+		(((*handlers)[Base + Offsets] = &Invoker<Offsets, Base + Offsets,
+		      Operation>::template execute<Control>),
+		    ...);
+	}
+	/**
+	 * Compiles microcode
+	 *
+	 * @return Compiled microcode
+	 */
+	template <class Control, std::size_t... Indices>
+	static constexpr handlers_t makeHandlers(std::index_sequence<Indices...>) {
+		handlers_t handlers{};
+		(fillHandlers<Control, Operations, offsets[Indices]>(
+		     &handlers, std::make_index_sequence<Operations::Size>()),
+		    ...);
+		return handlers;
+	}
 
-/**
- * Implementation of invocation
- */
-template <class... Operations>
-struct Invoke<class_pack<Operations...>> {
+public:
 	/**
-	 * Executes operation
+	 * Executes microcode from index
 	 *
 	 * @param cpu CPU
 	 * @param index Index
 	 */
 	template <class Control>
 	static void execute(CCPU *cpu, std::size_t index) {
-		typedef void (*handler)(CCPU *);
-		static const handler handlers[sizeof...(Operations)] = {
-		    (&Operations::template execute<Control>) ...};
+		static constexpr handlers_t handlers = makeHandlers<Control>(
+		    std::index_sequence_for<Operations...>());
 		(*handlers[index])(cpu);
 	}
 };
@@ -258,84 +319,31 @@ struct Opcode {
 };
 
 /**
- * Stores code and offset in compile time
- */
-template <std::uint8_t Code, std::size_t Offset>
-struct OpcodeOffset {
-	using type = OpcodeOffset;
-	enum { offset = Offset };
-	enum { code = Code };
-};
-
-/**
- * Expands operations into opcode data
- */
-template <class OperationOffsets, class OpcodePack>
-struct OpcodeData;
-
-/**
- * Implements expansion for opcodes
- */
-template <class OperationOffsets, class... Opcodes>
-struct OpcodeData<OperationOffsets, class_pack<Opcodes...>>
-    : class_pack<OpcodeOffset<Opcodes::code,
-          OperationOffsets::template type<
-              typename Opcodes::operation>::offset>...> {};
-
-/**
- * Declares opcode finder
- */
-template <std::size_t DefaultOffset, class OpcodeOffsetPack>
-struct FindOpcode;
-
-/**
- * Empty opcode finder
+ * Parses opcode
  */
-template <std::size_t DefaultOffset>
-struct FindOpcode<DefaultOffset, class_pack<>> {
-	/**
-	 * Looks up opcode offset
-	 *
-	 * @param code Opcode
-	 * @return Opcode offset
-	 */
-	static constexpr std::size_t find(std::uint8_t code) {
-		return DefaultOffset;
-	}
-};
+template <class Layout, class DefaultOperation, class OpcodePack>
+struct OpcodeParser;
 
 /**
- * Implements opcode finder
+ * Implementation of opcode parser
  */
-template <std::size_t DefaultOffset, class FirstOffset, class... OtherOffsets>
-struct FindOpcode<DefaultOffset, class_pack<FirstOffset, OtherOffsets...>> {
+template <class Layout, class DefaultOperation, class... Opcodes>
+struct OpcodeParser<Layout, DefaultOperation, class_pack<Opcodes...>> {
 	/**
-	 * Looks up opcode offset
+	 * Builds opcode table
 	 *
-	 * @param code Opcode
-	 * @return Opcode offset
+	 * @return Indices in compiled microcode mapped to opcodes
 	 */
-	static constexpr std::size_t find(std::uint8_t code) {
-		if (code == FirstOffset::code) {
-			return FirstOffset::offset;
-		} else {
-			return FindOpcode<DefaultOffset, class_pack<OtherOffsets...>>::find(
-			    code);
+	static constexpr std::array<std::size_t, 0x100> makeCodes() {
+		std::array<std::size_t, 0x100> codes{};
+		for (std::size_t &code : codes) {
+			code = Layout::template getOffset<DefaultOperation>();
 		}
+		((codes[Opcodes::code] = Layout::template getOffset<
+		      typename Opcodes::operation>()),
+		    ...);
+		return codes;
 	}
-};
-
-/**
- * Parses opcode
- */
-template <class OpcodeFinder, class IndexPack>
-struct OpcodeParser;
-
-/**
- * Implementation of opcode parser
- */
-template <std::size_t... Codes, class OpcodeFinder>
-struct OpcodeParser<OpcodeFinder, std::index_sequence<Codes...>> {
 	/**
 	 * Looks up code and returns index in compiled microcode
 	 *
@@ -343,30 +351,28 @@ struct OpcodeParser<OpcodeFinder, std::index_sequence<Codes...>> {
 	 * @return Index in compiled microcode
 	 */
 	static std::size_t parseOpcode(std::uint8_t code) {
-		static const std::size_t codes[sizeof...(Codes)] = {
-		    OpcodeFinder::find(Codes)...};
+		static constexpr std::array<std::size_t, 0x100> codes = makeCodes();
 		return codes[code];
 	}
 };
 
 /**
- * Converts opcode pack to operation pack
+ * Converts opcode pack to operation layout
  */
 template <class OpcodePack, class... Operations>
 struct ExpandOperations;
 
 /**
- * Implementation for converting opcode pack to operation pack
+ * Implementation for converting opcode pack to operation layout
  */
 template <class... Opcodes, class... Operations>
 struct ExpandOperations<class_pack<Opcodes...>, Operations...>
-    : distinct_class_pack<
-          class_pack<Operations..., typename Opcodes::operation...>> {};
+    : OperationLayout<Operations..., typename Opcodes::operation...> {};
 
 /**
  * CPU control
  */
-template <class OpcodeControl>
+template <class OpcodeControl, class StepMode>
 struct Control {
 	/**
 	 * Opcode pack
@@ -377,29 +383,18 @@ struct Control {
 	 */
 	using operation_jam = Operation<Cycle>;
 	/**
-	 * Operation pack
+	 * Operation layout
 	 */
-	using operation_pack = typename ExpandOperations<opcode_pack,
+	using operation_layout = typename ExpandOperations<opcode_pack,
 	    typename OpcodeControl::opReset, operation_jam>::type;
 	/**
-	 * Operation offsets
-	 */
-	struct operation_offset : OperationOffsetExpand<operation_pack> {};
-	/**
-	 * Opcode data
-	 */
-	using opcode_data =
-	    typename OpcodeData<operation_offset, opcode_pack>::type;
-	/**
-	 * Opcode finder
+	 * Opcode parser
 	 */
-	using opcode_finder =
-	    FindOpcode<operation_offset::template type<operation_jam>::offset,
-	        opcode_data>;
+	using opcode_parser =
+	    OpcodeParser<operation_layout, operation_jam, opcode_pack>;
 	enum {
-		ResetIndex =
-		    operation_offset::template type<typename OpcodeControl::opReset>::
-		        offset  //!< Reset in compiled microcode
+		ResetIndex = operation_layout::template getOffset<
+		    typename OpcodeControl::opReset>()  //!< Reset in compiled microcode
 	};
 
 	/**
@@ -420,7 +415,8 @@ struct Control {
 	 * @return If could or not
 	 */
 	static bool accessBus(CCPU *cpu, CCPU::EBusMode busMode, bool ackIRQ) {
-		return OpcodeControl::accessBus(cpu, busMode, ackIRQ);
+		return OpcodeControl::template accessBus<StepMode>(
+		    cpu, busMode, ackIRQ);
 	}
 	/**
 	 * Executes microcode from index
@@ -429,8 +425,7 @@ struct Control {
 	 * @param index Index
 	 */
 	static void execute(CCPU *cpu, std::size_t index) {
-		Invoke<typename InvokeExpand<0,
-		    operation_pack>::type>::template execute<Control>(cpu, index);
+		operation_layout::template execute<Control>(cpu, index);
 	}
 	/**
 	 * Looks up code and returns index in compiled microcode
@@ -439,8 +434,7 @@ struct Control {
 	 * @return Index in compiled microcode
 	 */
 	static std::size_t parseOpcode(std::uint8_t code) {
-		return OpcodeParser<opcode_finder,
-		    std::make_index_sequence<0x100>>::parseOpcode(code);
+		return opcode_parser::parseOpcode(code);
 	}
 };
 
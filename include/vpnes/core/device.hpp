@@ -32,6 +32,7 @@
 
 #include <cassert>
 #include <cstddef>
+#include <functional>
 #include <utility>
 #include <type_traits>
 #include <memory>
@@ -389,13 +390,19 @@ private:
 		/**
 		 * Special routine for comparison of event data pointers
 		 *
+		 * Events with equal time are ordered by address so they can coexist
+		 * in the queue.
+		 *
 		 * @param left Left operand
 		 * @param right Right operand
 		 * @return *Left < *Right
 		 */
 		static bool compare(SEventData *const left, SEventData *const right) {
 			assert(right->m_Enabled && left->m_Enabled);
-			return left->m_Time < right->m_Time;
+			if (left->m_Time != right->m_Time) {
+				return left->m_Time < right->m_Time;
+			}
+			return std::less<SEventData *>()(left, right);
 		}
 	};
 	/**
@@ -428,9 +435,9 @@ protected:
 	 */
 	void updateClock() {
 		ticks_t newClock = m_Clock;
-		EventQueue::const_reverse_iterator iter = m_EventQueue.crbegin();
+		EventQueue::const_iterator iter = m_EventQueue.cbegin();
 
-		if (iter == m_EventQueue.crend()) {
+		if (iter == m_EventQueue.cend()) {
 			newClock = m_LocalTime;
 		} else {
 			newClock = (*iter)->m_Time;
@@ -446,8 +453,8 @@ protected:
 	 * @return New clock value
 	 */
 	ticks_t generateTicks() {
-		EventQueue::const_reverse_iterator iter = m_EventQueue.crbegin();
-		assert(iter != m_EventQueue.crend());
+		EventQueue::const_iterator iter = m_EventQueue.cbegin();
+		assert(iter != m_EventQueue.cend());
 		return (*iter)->m_Time;
 	}
 	/**
@@ -455,8 +462,8 @@ protected:
 	 */
 	void fireEvents() {
 		for (;;) {
-			EventQueue::const_reverse_iterator iter = m_EventQueue.crbegin();
-			if (iter == m_EventQueue.crend() || (*iter)->m_Time > m_Clock) {
+			EventQueue::const_iterator iter = m_EventQueue.cbegin();
+			if (iter == m_EventQueue.cend() || (*iter)->m_Time > m_Clock) {
 				break;
 			}
 			(*iter)->m_Event->fire();
@@ -30,12 +30,32 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <vpnes/vpnes.hpp>
 
 namespace vpnes {
 
 namespace core {
 
+namespace frame {
+
+/**
+ * Output frame format
+ *
+ * Each pixel is a 6-bit NES color with emphasis bits above it.
+ */
+enum {
+	Width = 256,           //!< Frame width
+	Height = 240,          //!< Frame height
+	ColorMask = 0x3f,      //!< NES color bits
+	GrayscaleMask = 0x30,  //!< NES color bits in grayscale mode
+	EmphasisShift = 6,     //!< Position of emphasis bits
+	Colors = 0x200         //!< Number of distinct pixel values
+};
+
+}  // namespace frame
+
 /**
  * Front-end
  */
@@ -56,12 +76,40 @@ public:
 	 */
 	virtual ~CFrontEnd() = default;
 
+	/**
+	 * Gets buffer for the next frame
+	 *
+	 * The PPU renders directly into the buffer until the frame is ready.
+	 * Null buffer disables pixel output.
+	 *
+	 * @return Frame buffer (frame::Width * frame::Height) or nullptr
+	 */
+	virtual std::uint16_t *getFrameBuffer() = 0;
 	/**
 	 * Frame-ready callback
 	 *
 	 * @param frameTime Frame time
 	 */
 	virtual void handleFrameRender(double frameTime) = 0;
+	/**
+	 * Gets output sample rate
+	 *
+	 * Queried before each audio block, so the rate can be adjusted on the
+	 * fly. Zero disables audio synthesis.
+	 *
+	 * @return Sample rate in Hz
+	 */
+	virtual double getSampleRate() {
+		return 0;
+	}
+	/**
+	 * Audio-ready callback
+	 *
+	 * @param samples Signed 16-bit mono samples
+	 * @param count Number of samples
+	 */
+	virtual void handleAudio(const std::int16_t *samples, std::size_t count) {
+	}
 };
 
 }  // namespace core
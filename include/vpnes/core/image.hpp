@@ -0,0 +1,258 @@
+/**
+ * @file
+ *
+ * Defines memory-mapped ROM images and their registry
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_CORE_IMAGE_HPP_
+#define INCLUDE_VPNES_CORE_IMAGE_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+namespace ppu {
+
+class CTileCache;
+
+}  // namespace ppu
+
+/**
+ * File identity
+ *
+ * Equal identities name the same unchanged file, so its contents need not
+ * be read to compare it with a loaded one.
+ */
+struct SFileID {
+	std::uint64_t Device;  //!< Device (volume serial number on Windows)
+	std::uint64_t Index;   //!< Inode (file index on Windows)
+	std::uint64_t Size;    //!< File size
+	std::int64_t Time;     //!< Last modification time
+
+	/**
+	 * Orders identities
+	 *
+	 * @param s Compared value
+	 * @return True if less
+	 */
+	bool operator<(const SFileID &s) const {
+		return std::tie(Device, Index, Size, Time) <
+		       std::tie(s.Device, s.Index, s.Size, s.Time);
+	}
+};
+
+/**
+ * ROM file mapped read-only into memory
+ *
+ * The pages are loaded by the OS on first access and are shared with the
+ * page cache, so ROM data is never copied.
+ */
+class CROMImage {
+private:
+	/**
+	 * Mapped file contents
+	 */
+	const std::uint8_t *m_Data;
+	/**
+	 * File size
+	 */
+	std::size_t m_Size;
+	/**
+	 * Identity of the mapped file
+	 */
+	SFileID m_FileID;
+	/**
+	 * Guard for decoding of pattern tables
+	 */
+	mutable std::once_flag m_TilesFlag;
+	/**
+	 * Pattern tables decoded from CHR ROM
+	 */
+	mutable std::unique_ptr<ppu::CTileCache> m_Tiles;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CROMImage() = delete;
+	/**
+	 * Maps the file
+	 *
+	 * @param fileName File path
+	 */
+	explicit CROMImage(const std::string &fileName);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CROMImage(const CROMImage &s) = delete;
+	/**
+	 * Unmaps the file
+	 */
+	~CROMImage();
+
+	/**
+	 * Gets file contents
+	 *
+	 * @return Pointer to the first byte
+	 */
+	const std::uint8_t *getData() const {
+		return m_Data;
+	}
+	/**
+	 * Gets file size
+	 *
+	 * @return Size in bytes
+	 */
+	std::size_t getSize() const {
+		return m_Size;
+	}
+	/**
+	 * Gets identity of the mapped file
+	 *
+	 * @return File identity
+	 */
+	const SFileID &getFileID() const {
+		return m_FileID;
+	}
+	/**
+	 * Gets pattern tables decoded from CHR ROM
+	 *
+	 * The tiles are decoded on the first call and shared by all users of the
+	 * image. Every call must pass the same CHR ROM.
+	 *
+	 * @param offset Offset of 8 KB CHR ROM in the file
+	 * @return Decoded pattern tables
+	 */
+	const ppu::CTileCache &getTiles(std::size_t offset) const;
+};
+
+/**
+ * Registry of loaded ROM images
+ *
+ * Images with the same contents are handed out as one shared object, so
+ * instances running the same ROM keep one mapping and one set of decoded
+ * pattern tables. The registry only holds weak references and an image is
+ * unmapped with its last user.
+ */
+class CROMRegistry {
+public:
+	/**
+	 * Content hash function
+	 */
+	typedef std::uint64_t (*hash_t)(const CROMImage &image);
+
+private:
+	/**
+	 * Lock for images
+	 */
+	mutable std::mutex m_Mutex;
+	/**
+	 * Content hash function
+	 */
+	hash_t m_Hash;
+	/**
+	 * Loaded images by content hash
+	 */
+	std::unordered_multimap<std::uint64_t, std::weak_ptr<const CROMImage>>
+	    m_Images;
+	/**
+	 * Loaded images by identity of files with their contents
+	 */
+	std::map<SFileID, std::weak_ptr<const CROMImage>> m_Files;
+
+	/**
+	 * Computes content hash
+	 *
+	 * @param image ROM image
+	 * @return Hash value
+	 */
+	static std::uint64_t getHash(const CROMImage &image);
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param hash Content hash function
+	 */
+	explicit CROMRegistry(hash_t hash = getHash);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CROMRegistry(const CROMRegistry &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CROMRegistry() = default;
+
+	/**
+	 * Loads an image or reuses one with the same contents
+	 *
+	 * A file already seen with the same identity is reused without being
+	 * read. Other files are mapped and hashed, so a copy of a loaded ROM
+	 * costs one pass over the file the first time it is seen.
+	 *
+	 * @param fileName File path
+	 * @return Shared image
+	 */
+	std::shared_ptr<const CROMImage> getImage(const std::string &fileName);
+	/**
+	 * Gets number of registered images
+	 *
+	 * Images that are no longer used are counted until the next new image
+	 * is added.
+	 *
+	 * @return Number of images
+	 */
+	std::size_t getCount() const;
+
+	/**
+	 * Gets process-wide registry
+	 *
+	 * @return Registry
+	 */
+	static CROMRegistry &getRegistry();
+};
+
+}  // namespace core
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_CORE_IMAGE_HPP_
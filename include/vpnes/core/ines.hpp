@@ -33,9 +33,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <vector>
-#include <fstream>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/config.hpp>
+#include <vpnes/core/image.hpp>
 
 namespace vpnes {
 
@@ -124,22 +124,23 @@ struct SNESData {
 	 */
 	ENESType NESType;
 	/**
-	 * PRG ROM
+	 * PRG ROM (points into the image)
 	 */
-	std::vector<std::uint8_t> PRG;
+	const std::uint8_t *PRG;
 	/**
-	 * CHR ROM
+	 * CHR ROM (points into the image, nullptr if absent)
 	 */
-	std::vector<std::uint8_t> CHR;
+	const std::uint8_t *CHR;
 	/**
 	 * Trainer hacks
 	 */
 	std::vector<std::uint8_t> Trainer;
 	/**
 	 * Constructs the structure from the data
-	 * @param ROM
+	 *
+	 * @param ROM ROM image
 	 */
-	explicit SNESData(std::ifstream *ROM);
+	explicit SNESData(const CROMImage &ROM);
 	/**
 	 * Deleted default constructor
 	 */
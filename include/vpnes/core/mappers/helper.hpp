@@ -33,6 +33,7 @@
 #include <cassert>
 #include <cstdint>
 #include <array>
+#include <stdexcept>
 #include <unordered_map>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/debugger.hpp>
@@ -203,7 +204,7 @@ public:
 /**
  * Basic NES implementation based on config
  */
-template <class Config, class MMCType, class... Devices>
+template <class Config, class Profile, class MMCType, class... Devices>
 class CNESHelper : public CNES {
 private:
 	/**
@@ -217,7 +218,7 @@ private:
 	/**
 	 * PPU
 	 */
-	CPPU m_PPU;
+	CPPU<typename Profile::PPURender> m_PPU;
 	/**
 	 * APU
 	 */
@@ -247,13 +248,19 @@ public:
 	    const SNESConfig &config, CFrontEnd *frontEnd, Devices *... devices)
 	    : CNES()
 	    , m_MotherBoard(frontEnd)
-	    , m_CPU(&m_MotherBoard)
-	    , m_PPU(&m_MotherBoard, Config::getFrequency(), Config::FrameTime)
-	    , m_APU(&m_MotherBoard)
+	    , m_CPU(&m_MotherBoard, typename Profile::CPUStep())
+	    , m_PPU(&m_MotherBoard, &m_CPU, Config::getFrequency(),
+	          Config::FrameTime)
+	    , m_APU(&m_MotherBoard, &m_CPU, Config::getFrequency(),
+	          Config::FrameTime)
 	    , m_MMC(&m_MotherBoard, config)
 	    , m_Debugger(&m_MotherBoard) {
-		m_MotherBoard.addBusCPU(&m_CPU, &m_APU, &m_PPU, &m_MMC, devices...);
-		m_MotherBoard.addBusPPU(&m_MMC, devices...);
+		m_MotherBoard.template addBusCPU<typename Profile::BusConflict>(
+		    &m_CPU, &m_APU, &m_PPU, &m_MMC, devices...);
+		m_MotherBoard.template addBusPPU<typename Profile::BusConflict>(
+		    &m_MMC, devices...);
+		m_PPU.addHooksPPU(m_MotherBoard.getBusPPU());
+		m_PPU.setTiles(m_MMC.getTiles());
 		m_MotherBoard.registerSimDevices(&m_CPU, &m_APU, &m_PPU, &m_MMC);
 	}
 	/**
@@ -295,6 +302,144 @@ struct SConfigNTSC {
 	}
 };
 
+/**
+ * Cycle-exact profile
+ */
+struct SProfileAccurate {
+	/**
+	 * CPU stepping
+	 */
+	typedef cpu::CycleStep CPUStep;
+	/**
+	 * PPU rendering
+	 */
+	typedef ppu::DotRender PPURender;
+	/**
+	 * Bus conflicts
+	 */
+	typedef banks::ConflictExact BusConflict;
+
+	/**
+	 * Profile name
+	 *
+	 * @return Name
+	 */
+	static constexpr const char *getName() {
+		return "accurate";
+	}
+};
+
+/**
+ * Fast profile for bulk runs
+ */
+struct SProfileFast {
+	/**
+	 * CPU stepping
+	 */
+	typedef cpu::InstructionStep CPUStep;
+	/**
+	 * PPU rendering
+	 */
+	typedef ppu::ScanlineRender PPURender;
+	/**
+	 * Bus conflicts
+	 */
+	typedef banks::ConflictRelaxed BusConflict;
+
+	/**
+	 * Profile name
+	 *
+	 * @return Name
+	 */
+	static constexpr const char *getName() {
+		return "fast";
+	}
+};
+
+/**
+ * Fast profile with pixels composed on worker threads
+ */
+struct SProfileThreaded {
+	/**
+	 * CPU stepping
+	 */
+	typedef cpu::InstructionStep CPUStep;
+	/**
+	 * PPU rendering
+	 */
+	typedef ppu::DeferredRender PPURender;
+	/**
+	 * Bus conflicts
+	 */
+	typedef banks::ConflictRelaxed BusConflict;
+
+	/**
+	 * Profile name
+	 *
+	 * @return Name
+	 */
+	static constexpr const char *getName() {
+		return "threaded";
+	}
+};
+
+/**
+ * Available profiles
+ */
+typedef class_pack<SProfileAccurate, SProfileFast, SProfileThreaded>
+    ProfilePack;
+
+/**
+ * Looks up profile by name
+ */
+template <class ProfilePack>
+struct ProfileFactory;
+
+/**
+ * No profile found
+ */
+template <>
+struct ProfileFactory<class_pack<>> {
+	/**
+	 * Creates NES
+	 *
+	 * @param config NES config
+	 * @param frontEnd Front-end
+	 * @param devices Additional devices
+	 * @return NES
+	 */
+	template <class T, class... Devices>
+	static CNES *create(
+	    const SNESConfig &config, CFrontEnd *frontEnd, Devices *... devices) {
+		throw std::invalid_argument("Unknown profile");
+	}
+};
+
+/**
+ * Implementation of profile look up
+ */
+template <class Profile, class... OtherProfiles>
+struct ProfileFactory<class_pack<Profile, OtherProfiles...>> {
+	/**
+	 * Creates NES
+	 *
+	 * @param config NES config
+	 * @param frontEnd Front-end
+	 * @param devices Additional devices
+	 * @return NES
+	 */
+	template <class T, class... Devices>
+	static CNES *create(
+	    const SNESConfig &config, CFrontEnd *frontEnd, Devices *... devices) {
+		if (config.Profile == Profile::getName()) {
+			return new CNESHelper<SConfigNTSC, Profile, T, Devices...>(
+			    config, frontEnd, devices...);
+		}
+		return ProfileFactory<class_pack<OtherProfiles...>>::template create<
+		    T>(config, frontEnd, devices...);
+	}
+};
+
 /**
  * Basic NES factory
  *
@@ -306,7 +451,7 @@ struct SConfigNTSC {
 template <class T, class... Devices>
 CNES *factoryNES(
     const SNESConfig &config, CFrontEnd *frontEnd, Devices *... devices) {
-	return new CNESHelper<SConfigNTSC, T, Devices...>(
+	return ProfileFactory<ProfilePack>::template create<T>(
 	    config, frontEnd, devices...);
 }
 
@@ -33,12 +33,14 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/device.hpp>
 #include <vpnes/core/bus.hpp>
 #include <vpnes/core/mboard.hpp>
 #include <vpnes/core/config.hpp>
+#include <vpnes/core/image.hpp>
 
 namespace vpnes {
 
@@ -86,13 +88,14 @@ public:
 		    MemoryMap::iterator iterWrite, MemoryMap::iterator iterMod,
 		    std::uint8_t *openBus, std::uint8_t *dummy, std::uint8_t *writeBuf,
 		    CNROM *device) {
+			// ROM banks only read the buffer, so it can stay write-protected
+			std::uint8_t *prg = const_cast<std::uint8_t *>(device->m_PRG);
 			BankConfig::mapIO(iterRead, iterWrite, iterMod, openBus, dummy,
 			    writeBuf, nullptr, device->m_RAM.data(),
 			    device->m_RAM.data() + (0x0800 & (device->m_RAM.size() - 1)),
 			    device->m_RAM.data() + (0x1000 & (device->m_RAM.size() - 1)),
 			    device->m_RAM.data() + (0x1800 & (device->m_RAM.size() - 1)),
-			    device->m_PRG.data(),
-			    device->m_PRG.data() + (0x4000 & (device->m_PRG.size() - 1)));
+			    prg, prg + (0x4000 & (device->m_PRGSize - 1)));
 		}
 		/**
 		 * Checks if device is enabled
@@ -167,10 +170,11 @@ public:
 		    MemoryMap::iterator iterWrite, MemoryMap::iterator iterMod,
 		    std::uint8_t *openBus, std::uint8_t *dummy, std::uint8_t *writeBuf,
 		    CNROM *device) {
+			std::uint8_t *chr = const_cast<std::uint8_t *>(device->m_CHR);
 			switch (device->m_Mirroring) {
 			case MirroringHorizontal:
 				BankConfig::mapIO(iterRead, iterWrite, iterMod, openBus, dummy,
-				    writeBuf, device->m_CHR.data(), device->m_CHR.data(),
+				    writeBuf, chr, chr,
 				    device->m_NameTable, device->m_NameTable + 0x0400,
 				    device->m_NameTable, device->m_NameTable + 0x0400,
 				    device->m_NameTable, device->m_NameTable + 0x0400,
@@ -178,7 +182,7 @@ public:
 				break;
 			case MirroringVertical:
 				BankConfig::mapIO(iterRead, iterWrite, iterMod, openBus, dummy,
-				    writeBuf, device->m_CHR.data(), device->m_CHR.data(),
+				    writeBuf, chr, chr,
 				    device->m_NameTable, device->m_NameTable,
 				    device->m_NameTable + 0x0400, device->m_NameTable + 0x0400,
 				    device->m_NameTable, device->m_NameTable,
@@ -216,14 +220,26 @@ public:
 	};
 
 private:
+	/**
+	 * Mapped ROM file shared with other instances
+	 */
+	std::shared_ptr<const CROMImage> m_Image;
 	/**
 	 * PRG ROM
 	 */
-	std::vector<std::uint8_t> m_PRG;
+	const std::uint8_t *m_PRG;
+	/**
+	 * PRG ROM size
+	 */
+	std::size_t m_PRGSize;
 	/**
 	 * CHR ROM / CHR RAM
 	 */
-	std::vector<std::uint8_t> m_CHR;
+	const std::uint8_t *m_CHR;
+	/**
+	 * CHR RAM
+	 */
+	std::vector<std::uint8_t> m_CHRRAM;
 	/**
 	 * PRG RAM
 	 */
@@ -280,6 +296,18 @@ public:
 	void addHooksPPU(CBus *bus) {
 	}
 
+	/**
+	 * Gets decoded pattern tables shared with other instances
+	 *
+	 * @return Decoded CHR ROM (nullptr for CHR RAM)
+	 */
+	const ppu::CTileCache *getTiles() const {
+		if (!m_CHRRAM.empty()) {
+			return nullptr;
+		}
+		return &m_Image->getTiles(m_CHR - m_Image->getData());
+	}
+
 	/**
 	 * Gets pending time
 	 *
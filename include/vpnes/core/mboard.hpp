@@ -171,10 +171,11 @@ public:
 	 *
 	 * @param devices Devices on PPU bus
 	 */
-	template <class... Devices>
+	template <class BusConflict, class... Devices>
 	void addBusPPU(Devices *... devices) {
 		m_BusPPU.reset(
-		    new CBusConfig<typename Devices::PPUConfig...>(0x00, devices...));
+		    new CBusConfig<BusConflict, typename Devices::PPUConfig...>(
+		        0x00, devices...));
 		addHooksPPU(devices...);
 	}
 	/**
@@ -182,10 +183,11 @@ public:
 	 *
 	 * @param devices Devices on CPU bus
 	 */
-	template <class... Devices>
+	template <class BusConflict, class... Devices>
 	void addBusCPU(Devices *... devices) {
 		m_BusCPU.reset(
-		    new CBusConfig<typename Devices::CPUConfig...>(0x40, devices...));
+		    new CBusConfig<BusConflict, typename Devices::CPUConfig...>(
+		        0x40, devices...));
 		addHooksCPU(devices...);
 	}
 
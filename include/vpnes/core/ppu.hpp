@@ -30,20 +30,67 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/device.hpp>
 #include <vpnes/core/bus.hpp>
 #include <vpnes/core/mboard.hpp>
+#include <vpnes/core/frontend.hpp>
+#include <vpnes/core/cpu.hpp>
+#include <vpnes/core/workers.hpp>
+#include <vpnes/core/ppu_render.hpp>
+#include <vpnes/core/ppu_compile.hpp>
 
 namespace vpnes {
 
 namespace core {
 
+namespace ppu {
+
+/**
+ * Dot-based rendering (PPU state is exact on each dot)
+ */
+struct DotRender {
+	enum {
+		Scanline = false,  //!< Render by scanlines
+		Deferred = false   //!< Compose pixels on worker threads
+	};
+};
+
+/**
+ * Scanline-based rendering (PPU state is resolved once per scanline)
+ */
+struct ScanlineRender {
+	enum {
+		Scanline = true,  //!< Render by scanlines
+		Deferred = false  //!< Compose pixels on worker threads
+	};
+};
+
+/**
+ * Scanline-based rendering with pixels composed on worker threads
+ *
+ * Only the state visible to the CPU is resolved inline. Render state of
+ * each line is logged and bands of lines are composed by workers.
+ */
+struct DeferredRender {
+	enum {
+		Scanline = true,  //!< Render by scanlines
+		Deferred = true   //!< Compose pixels on worker threads
+	};
+};
+
+}  // namespace ppu
+
 /**
  * Basic PPU
  */
+template <class RenderMode>
 class CPPU : public CEventDevice {
 public:
 	/**
@@ -96,14 +143,27 @@ public:
 	};
 
 private:
+	friend class ppu::CVBlankUnit<CPPU>;
+	friend class ppu::CBackgroundUnit<CPPU>;
+	friend class ppu::CObjectUnit<CPPU>;
+	friend class ppu::CMultiplexerUnit<CPPU>;
+
 	/**
 	 * Motherboard
 	 */
 	CMotherBoard *m_MotherBoard;
+	/**
+	 * CPU
+	 */
+	CCPU *m_CPU;
 	/**
 	 * Palette
 	 */
 	std::uint8_t m_Palette[0x0020];
+	/**
+	 * Output colors of palette entries with grayscale and emphasis applied
+	 */
+	std::uint16_t m_Colors[0x0020];
 	/**
 	 * IO Buffer
 	 */
@@ -116,6 +176,103 @@ private:
 	 * Frequency
 	 */
 	double m_Freq;
+	/**
+	 * Start time of current scanline
+	 */
+	ticks_t m_LineClock;
+	/**
+	 * Current scanline
+	 */
+	int m_Scanline;
+	/**
+	 * Dot of the next scanline step
+	 */
+	int m_LineDot;
+	/**
+	 * Decoded line
+	 */
+	std::uint8_t m_LineBuffer[ppu::LinePixels];
+	/**
+	 * Frame buffer supplied by front-end (null if pixels are not needed)
+	 */
+	std::uint16_t *m_FrameBuffer;
+	/**
+	 * Background pixels produced by background fetcher
+	 */
+	std::uint8_t m_BackgroundBuffer[ppu::ScreenWidth * ppu::ScreenHeight];
+	/**
+	 * Object pixels produced by sprite evaluator
+	 */
+	std::uint8_t m_ObjectBuffer[ppu::ScreenWidth * ppu::ScreenHeight];
+	/**
+	 * Object attribute memory
+	 */
+	ppu::SObjectMemory m_OAM;
+	/**
+	 * OAM address
+	 */
+	std::uint8_t m_OAMAddr;
+	/**
+	 * Objects found for the next line in scanline mode
+	 */
+	ppu::SObjectList m_LineObjects;
+	/**
+	 * Dot of object 0 hit in scanline mode (0 if none)
+	 */
+	int m_HitDot;
+	/**
+	 * Dot of object overflow in scanline mode (0 if none)
+	 */
+	int m_OverflowDot;
+	/**
+	 * Last screen line with fetched object 0 (-1 if none)
+	 */
+	int m_ObjectZeroLine;
+	/**
+	 * Pattern tables decoded by this PPU (nullptr if shared)
+	 */
+	std::unique_ptr<ppu::CTileCache> m_TileCache;
+	/**
+	 * Decoded pattern tables in use
+	 */
+	const ppu::CTileCache *m_Tiles;
+	/**
+	 * Decoded nametable rows
+	 */
+	ppu::CBackgroundCache m_BackgroundCache;
+	/**
+	 * Vertical blank timing
+	 */
+	ppu::CVBlankUnit<CPPU> m_VBlankUnit;
+	/**
+	 * Background fetcher
+	 */
+	ppu::CBackgroundUnit<CPPU> m_BackgroundUnit;
+	/**
+	 * Sprite evaluator
+	 */
+	ppu::CObjectUnit<CPPU> m_ObjectUnit;
+	/**
+	 * Pixel multiplexer
+	 */
+	ppu::CMultiplexerUnit<CPPU> m_MultiplexerUnit;
+
+	/**
+	 * Scanline steps
+	 */
+	enum {
+		PPUDotRender = 0,                            //!< Render the line
+		PPUDotEvaluate = ppu::ObjectEvaluateDot,     //!< Find objects
+		PPUDotCopyHorizontal = ppu::ObjectFetchDot,  //!< Fetch objects, next Y
+		PPUDotCopyVertical = 304  //!< Reload Y on pre-render line
+	};
+
+	/**
+	 * Longest VRAM upload written at once
+	 */
+	enum {
+		PPUUploadSize = 0x0400  //!< One nametable
+	};
 
 	/**
 	 * Object sizes
@@ -197,6 +354,34 @@ private:
 	 * Trigger for first/second write to 5/6
 	 */
 	bool m_WriteTrigger;
+	/**
+	 * Buffered value of PPU memory read
+	 */
+	std::uint8_t m_ReadBuffer;
+	/**
+	 * Pending VRAM upload
+	 */
+	std::uint8_t m_Upload[PPUUploadSize];
+	/**
+	 * Start address of pending upload
+	 */
+	std::uint16_t m_UploadAddr;
+	/**
+	 * Size of pending upload
+	 */
+	std::size_t m_UploadSize;
+	/**
+	 * Render state of visible lines for deferred rendering
+	 */
+	ppu::SLineState m_LineLog[ppu::ScreenHeight];
+	/**
+	 * First logged line not passed to workers yet
+	 */
+	int m_FirstPendingLine;
+	/**
+	 * Workers composing deferred lines
+	 */
+	std::unique_ptr<CWorkerPool> m_Workers;
 
 	/**
 	 * Control register values
@@ -209,8 +394,8 @@ private:
 		PPUControlObjectPageSelector = 0x08,   //!< Selector for object page
 		PPUControlObjectSizeSelector = 0x20,   //!< Selector for object size
 		PPUControlClipBackground =
-		    0x02,  //!< Clip first 8px of screen for background
-		PPUControlClipObjects = 0x04,  //!< Clip first 8px of screen for objects
+		    0x02,  //!< Show first 8px of screen for background
+		PPUControlClipObjects = 0x04,  //!< Show first 8px of screen for objects
 		PPUControlEnableBackground = 0x08,  //!< Enable background rendering
 		PPUControlEnableObjects = 0x10      //!< Enable object rendering
 	};
@@ -232,30 +417,231 @@ private:
 	bool isRenderingEnabled() {
 		return m_EnableBackgound || m_EnableObjects;
 	}
+	/**
+	 * Gets first shown background pixel
+	 *
+	 * @return Pixel position
+	 */
+	int getBackgroundFirst() const {
+		if (!m_EnableBackgound) {
+			return ppu::ScreenWidth;
+		}
+		return m_ClipBackground ? ppu::TileWidth : 0;
+	}
+	/**
+	 * Gets first shown object pixel
+	 *
+	 * @return Pixel position
+	 */
+	int getObjectFirst() const {
+		if (!m_EnableObjects) {
+			return ppu::ScreenWidth;
+		}
+		return m_ClipObjects ? ppu::TileWidth : 0;
+	}
+	/**
+	 * Updates output colors after palette or mask change
+	 */
+	void updateColors() {
+		std::uint16_t mask =
+		    m_Grayscale ? frame::GrayscaleMask : frame::ColorMask;
+		std::uint16_t emphasis = m_TintIndex << frame::EmphasisShift;
+		for (std::size_t index = 0; index < 0x20; index++) {
+			m_Colors[index] = (m_Palette[index] & mask) | emphasis;
+		}
+	}
+	/**
+	 * Gets palette entry index
+	 *
+	 * Backdrop entries of object palettes mirror background ones.
+	 *
+	 * @param addr Address
+	 * @return Index in palette
+	 */
+	static std::size_t getPaletteIndex(std::uint16_t addr) {
+		std::size_t index = addr & 0x1f;
+		if ((index & 0x13) == 0x10) {
+			index &= 0x0f;
+		}
+		return index;
+	}
+	/**
+	 * Increments address after PPU memory access
+	 */
+	void incrementAddress() {
+		m_Addr_v = (m_Addr_v + (m_IncrementVertically ? 0x20 : 0x01)) & 0x7fff;
+	}
+	/**
+	 * Checks if VRAM writes can be delayed
+	 *
+	 * Rendering does not read VRAM after the last visible line, so
+	 * sequential writes are collected and written when needed.
+	 *
+	 * @return True if writes can be delayed
+	 */
+	bool canDelayWrites() {
+		return !m_IncrementVertically &&
+		       (!isRenderingEnabled() ||
+		           m_MotherBoard->getPending() >=
+		               ppu::ScanlinePostRender * ppu::LineTime);
+	}
+	/**
+	 * Adds a byte to pending VRAM upload
+	 *
+	 * @param val Value
+	 * @param addr Address
+	 */
+	void delayWrite(std::uint8_t val, std::uint16_t addr) {
+		if (m_UploadSize > 0 && (m_UploadSize == PPUUploadSize ||
+		                            addr != m_UploadAddr + m_UploadSize)) {
+			flushWrites();
+		}
+		if (m_UploadSize == 0) {
+			m_UploadAddr = addr;
+		}
+		m_Upload[m_UploadSize++] = val;
+	}
+	/**
+	 * Writes pending VRAM upload
+	 *
+	 * Memory is resolved once per page and the data is copied directly.
+	 * Bus hooks are skipped, so decoded tiles and rows are dropped here.
+	 */
+	void flushWrites() {
+		if (m_UploadSize == 0) {
+			return;
+		}
+		finishLines();
+		CBus *bus = m_MotherBoard->getBusPPU();
+		bool patterns = false;
+		std::size_t offset = 0;
+		while (offset < m_UploadSize) {
+			std::uint16_t addr = m_UploadAddr + offset;
+			std::size_t size = 0x0100 - (addr & 0xff);
+			if (size > m_UploadSize - offset) {
+				size = m_UploadSize - offset;
+			}
+			std::uint8_t *page = bus->getWritePage(addr >> 8);
+			if (page) {
+				std::memcpy(page + (addr & 0xff), m_Upload + offset, size);
+			}
+			for (std::size_t i = 0; i < size; i++, addr++) {
+				if (!page) {
+					bus->writeMemory(m_Upload[offset + i], addr, true);
+				}
+				if (addr < 0x2000) {
+					if (m_TileCache) {
+						m_TileCache->invalidate(addr);
+					}
+					patterns = true;
+				} else {
+					m_BackgroundCache.invalidate(addr);
+				}
+			}
+			offset += size;
+		}
+		if (patterns) {
+			m_BackgroundCache.invalidateAll();
+		}
+		m_UploadSize = 0;
+	}
 
+	/**
+	 * Catches up with current CPU time
+	 *
+	 * @param units Units to advance in dot mode
+	 */
+	template <class... Units>
+	void synchronize(Units *... units) {
+		ticks_t time = m_MotherBoard->getPending();
+		m_VBlankUnit.simulate(time);
+		if (RenderMode::Scanline) {
+			simulate(time);
+		} else {
+			(units->simulate(time), ...);
+		}
+	}
 	/**
 	 * Reads register
 	 *
 	 * @param addr register address
 	 */
 	void readReg(std::uint16_t addr) {
-		// TODO(me): respect read timings
 		switch (addr & 7) {
 		case 2:
+			synchronize(&m_MultiplexerUnit, &m_ObjectUnit);
 			m_IOBuf &= 0x1f;
 			m_IOBuf |= m_VerticalBlank;
 			m_IOBuf |= m_Object0Hit;
 			m_IOBuf |= m_ObjectOverflow;
-			// m_VerticalBlank = 0;
-			m_VerticalBlank ^= PPUStateVerticalBlank;  // For debug
+			m_VerticalBlank = 0;
+			m_WriteTrigger = false;
 			break;
 		case 4:
-			// TODO(me): implement OAM access
+			m_IOBuf = m_OAM.read(m_OAMAddr);
 			break;
-		case 7:
-			// TODO(me): implement PPU memory access
+		case 7: {
+			flushWrites();
+			synchronize(&m_BackgroundUnit);
+			CBus *bus = m_MotherBoard->getBusPPU();
+			std::uint16_t addr = m_Addr_v & 0x3fff;
+			if (addr >= 0x3f00) {
+				std::uint8_t mask = m_Grayscale ? frame::GrayscaleMask
+				                                : frame::ColorMask;
+				m_IOBuf = (m_IOBuf & 0xc0) |
+				          (m_Palette[getPaletteIndex(addr)] & mask);
+				// Buffer gets the nametable byte under the palette
+				m_ReadBuffer = bus->readMemory(addr & 0x2fff);
+			} else {
+				m_IOBuf = m_ReadBuffer;
+				m_ReadBuffer = bus->readMemory(addr);
+			}
+			incrementAddress();
 			break;
 		}
+		}
+	}
+	/**
+	 * Copies a page to OAM
+	 *
+	 * @param val Page number
+	 * @param addr Address
+	 */
+	void writeDMA(std::uint8_t val, std::uint16_t addr) {
+		synchronize(&m_ObjectUnit);
+		CBus *bus = m_MotherBoard->getBusCPU();
+		const std::uint8_t *page = bus->getPage(val);
+		if (page) {
+			m_OAM.load(page, m_OAMAddr);
+		} else {
+			for (std::uint16_t offset = 0; offset < 0x0100; offset++) {
+				m_OAM.write(m_OAMAddr++, bus->readMemory((val << 8) | offset));
+			}
+		}
+		m_CPU->haltDMA();
+	}
+	/**
+	 * Drops decoded tile on pattern write
+	 *
+	 * @param val Value
+	 * @param addr Address
+	 */
+	void writePattern(std::uint8_t val, std::uint16_t addr) {
+		finishLines();
+		if (m_TileCache) {
+			m_TileCache->invalidate(addr);
+		}
+		m_BackgroundCache.invalidateAll();
+	}
+	/**
+	 * Drops decoded background on nametable write
+	 *
+	 * @param val Value
+	 * @param addr Address
+	 */
+	void writeNameTable(std::uint8_t val, std::uint16_t addr) {
+		finishLines();
+		m_BackgroundCache.invalidate(addr);
 	}
 	/**
 	 * Writes to register
@@ -264,9 +650,13 @@ private:
 	 * @param addr Address
 	 */
 	void writeReg(std::uint8_t val, std::uint16_t addr) {
-		// TODO(me): respect write timings
 		switch (addr & 7) {
 		case 0:
+			synchronize(&m_BackgroundUnit, &m_ObjectUnit);
+			if (!m_GenerateNMI && (val & PPUControlGenerateNMI) &&
+			    m_VerticalBlank) {
+				m_CPU->triggerNMI();
+			}
 			m_Addr_t = (m_Addr_t & 0x73ff) | ((val & 0x03) << 10);
 			m_IncrementVertically = val & PPUControlIncrementVertically;
 			m_GenerateNMI = val & PPUControlGenerateNMI;
@@ -277,20 +667,25 @@ private:
 			                   : PPUObjectSize8x8;
 			break;
 		case 1:
+			flushWrites();
+			synchronize(&m_MultiplexerUnit, &m_BackgroundUnit, &m_ObjectUnit);
 			m_Grayscale = val & PPUControlGrayscale;
 			m_EnableBackgound = val & PPUControlEnableBackground;
-			m_ClipBackground = val & PPUControlClipBackground;
+			m_ClipBackground = ~val & PPUControlClipBackground;
 			m_EnableObjects = val & PPUControlEnableObjects;
-			m_ClipObjects = val & PPUControlClipObjects;
+			m_ClipObjects = ~val & PPUControlClipObjects;
 			m_TintIndex = val >> 5;
+			updateColors();
 			break;
-		case 2:
-			// TODO(me): implement object memory access
+		case 3:
+			m_OAMAddr = val;
 			break;
 		case 4:
-			// TODO(me): implement object memory access
+			synchronize(&m_ObjectUnit);
+			m_OAM.write(m_OAMAddr++, val);
 			break;
 		case 5:
+			synchronize(&m_BackgroundUnit);
 			m_WriteTrigger = !m_WriteTrigger;
 			if (m_WriteTrigger) {
 				m_RenderIndex = 0x10 | ((~val & 0x07) << 1);
@@ -301,27 +696,491 @@ private:
 			}
 			break;
 		case 6:
+			synchronize(&m_BackgroundUnit);
 			m_WriteTrigger = !m_WriteTrigger;
 			if (m_WriteTrigger) {
 				m_Addr_t = (m_Addr_t & 0x00ff) | ((val & 0x3f) << 8);
 			} else {
 				m_Addr_t = (m_Addr_t & 0x7f00) | val;
+				m_Addr_v = m_Addr_t;
 			}
 			break;
-		case 7:
-			// TODO(me): implement PPU memory access
+		case 7: {
+			synchronize(&m_MultiplexerUnit, &m_BackgroundUnit, &m_ObjectUnit);
+			std::uint16_t addr = m_Addr_v & 0x3fff;
+			if (addr >= 0x3f00) {
+				m_Palette[getPaletteIndex(addr)] = val & 0x3f;
+				updateColors();
+			} else if (canDelayWrites()) {
+				delayWrite(val, addr);
+			} else {
+				flushWrites();
+				m_MotherBoard->getBusPPU()->writeMemory(val, addr);
+			}
+			incrementAddress();
 			break;
 		}
+		}
+	}
+
+	/**
+	 * Gets fine X scroll
+	 *
+	 * @return Fine X
+	 */
+	std::size_t getFineX() const {
+		return 7 - ((m_RenderIndex >> 1) & 7);
+	}
+	/**
+	 * Increments Y component of the address
+	 */
+	void incrementY() {
+		if ((m_Addr_v & 0x7000) != 0x7000) {
+			m_Addr_v += 0x1000;
+			return;
+		}
+		m_Addr_v &= 0x0fff;
+		std::uint16_t coarseY = (m_Addr_v >> 5) & 0x1f;
+		if (coarseY == 29) {
+			coarseY = 0;
+			m_Addr_v ^= 0x0800;
+		} else if (coarseY == 31) {
+			coarseY = 0;
+		} else {
+			coarseY++;
+		}
+		m_Addr_v = (m_Addr_v & 0x0c1f) | (coarseY << 5);
+	}
+	/**
+	 * Increments X component of the address
+	 */
+	void incrementX() {
+		if ((m_Addr_v & 0x001f) == 0x001f) {
+			m_Addr_v = (m_Addr_v & 0x7fe0) ^ 0x0400;
+		} else {
+			m_Addr_v++;
+		}
+	}
+	/**
+	 * Reloads X component of the address
+	 */
+	void copyHorizontal() {
+		m_Addr_v = (m_Addr_v & 0x7be0) | (m_Addr_t & 0x041f);
+	}
+	/**
+	 * Reloads Y component of the address
+	 */
+	void copyVertical() {
+		m_Addr_v = (m_Addr_v & 0x041f) | (m_Addr_t & 0x7be0);
+	}
+	/**
+	 * Gets decoded pattern row
+	 *
+	 * @param addr Pattern address of the row
+	 * @param flip Flip horizontally
+	 * @return Pixels of the row
+	 */
+	const std::uint8_t *getPatternRow(std::uint16_t addr, bool flip) {
+		if (m_TileCache && !m_TileCache->isValid(addr)) {
+			CBus *bus = m_MotherBoard->getBusPPU();
+			std::uint8_t planes[ppu::CTileCache::TileSize];
+			std::uint16_t tile = addr & 0x1ff0;
+			for (std::uint16_t offset = 0; offset < ppu::CTileCache::TileSize;
+			     offset++) {
+				planes[offset] = bus->readMemory(tile | offset);
+			}
+			m_TileCache->update(addr, planes);
+		}
+		return m_Tiles->getRow(addr, flip);
+	}
+	/**
+	 * Reads pattern row bypassing bus hooks and tile cache
+	 *
+	 * Used by workers, so it does not change PPU state.
+	 *
+	 * @param addr Pattern address
+	 * @param flip Horizontal flip
+	 * @param pixels Output pixels
+	 */
+	void readPatternRow(std::uint16_t addr, bool flip, std::uint8_t *pixels) {
+		CBus *bus = m_MotherBoard->getBusPPU();
+		ppu::decodeTile(bus->readMemory(addr, true),
+		    bus->readMemory(addr | 0x08, true), pixels);
+		if (flip) {
+			std::reverse(pixels, pixels + ppu::TileWidth);
+		}
+	}
+	/**
+	 * Fetches background tiles of a line
+	 *
+	 * @param addr VRAM address at the start of the line
+	 * @param page Background pattern page
+	 * @param direct Bypass bus hooks
+	 * @param row Fetched row
+	 * @param getRow Pattern row getter
+	 */
+	template <class RowGetter>
+	void fetchBackground(std::uint16_t addr, std::uint16_t page, bool direct,
+	    ppu::SBackgroundRow *row, RowGetter getRow) {
+		CBus *bus = m_MotherBoard->getBusPPU();
+		std::uint16_t fineY = addr >> 12;
+		for (std::size_t tile = 0; tile < ppu::LineTiles; tile++) {
+			std::uint8_t tileIndex =
+			    bus->readMemory(0x2000 | (addr & 0x0fff), direct);
+			std::uint16_t pattern = page | (tileIndex << 4) | fineY;
+			std::uint8_t attribute = bus->readMemory(
+			    0x23c0 | (addr & 0x0c00) | ((addr >> 4) & 0x38) |
+			        ((addr >> 2) & 0x07),
+			    direct);
+			attribute >>= ((addr >> 4) & 0x04) | (addr & 0x02);
+			row->Palette[tile] = (attribute & 0x03) << 2;
+			std::memcpy(row->Pixels + tile * ppu::TileWidth, getRow(pattern),
+			    ppu::TileWidth);
+			if ((addr & 0x001f) == 0x001f) {
+				addr = (addr & 0x7fe0) ^ 0x0400;
+			} else {
+				addr++;
+			}
+		}
+	}
+	/**
+	 * Gets decoded nametable line
+	 *
+	 * @param addr VRAM address of the line
+	 * @return Pixels of the line starting with coarse X 0
+	 */
+	const std::uint8_t *getBackgroundLine(std::uint16_t addr) {
+		if (!m_BackgroundCache.isValid(addr, m_BackgroundPage)) {
+			ppu::SBackgroundRow row{};
+			std::uint8_t line[ppu::LinePixels];
+			fetchBackground(addr & 0x7fe0, m_BackgroundPage, false, &row,
+			    [this](std::uint16_t pattern) {
+				    return getPatternRow(pattern, false);
+			    });
+			ppu::decodeBackground(row, line);
+			m_BackgroundCache.update(addr, m_BackgroundPage, line);
+		}
+		return m_BackgroundCache.getLine(addr);
+	}
+	/**
+	 * Assembles current background line from decoded nametable lines
+	 *
+	 * @param line Output line
+	 */
+	void decodeBackground(std::uint8_t *line) {
+		std::size_t coarseX = m_Addr_v & 0x001f;
+		std::size_t split = (ppu::ScreenWidth / ppu::TileWidth - coarseX) *
+		                    ppu::TileWidth;
+		const std::uint8_t *first = getBackgroundLine(m_Addr_v);
+		std::memcpy(line, first + coarseX * ppu::TileWidth, split);
+		std::memcpy(line + split, getBackgroundLine(m_Addr_v ^ 0x0400),
+		    ppu::LineTiles * ppu::TileWidth - split);
+	}
+	/**
+	 * Finds objects for the next line
+	 *
+	 * @param line Screen line to prepare
+	 * @param list Found objects
+	 */
+	void evaluateObjects(int line, ppu::SObjectList *list) {
+		if (!isRenderingEnabled()) {
+			list->Count = 0;
+			list->Overflow = -1;
+			return;
+		}
+		ppu::selectObjects(ppu::findObjects(m_OAM, line, m_ObjectSize), list);
+	}
+	/**
+	 * Checks if pixels are composed inline
+	 *
+	 * @return True if composed inline
+	 */
+	bool isComposed() const {
+		return m_FrameBuffer && !RenderMode::Deferred;
+	}
+	/**
+	 * Checks if pixels are composed by workers
+	 *
+	 * @return True if composed by workers
+	 */
+	bool isDeferred() const {
+		return m_FrameBuffer && RenderMode::Deferred;
+	}
+	/**
+	 * Prepares found object for drawing
+	 *
+	 * @param index OAM index
+	 * @param line Screen line
+	 * @param object Prepared object
+	 */
+	void prepareObject(std::size_t index, int line, ppu::SLineObject *object) {
+		std::uint8_t tile = m_OAM.Tile[index];
+		std::uint8_t attribute = m_OAM.Attribute[index];
+		int row = line - 1 - m_OAM.Y[index];
+		if (attribute & 0x80) {
+			row = m_ObjectSize - 1 - row;
+		}
+		if (m_ObjectSize == PPUObjectSize8x16) {
+			object->Pattern = ((tile & 0x01) << 12) | ((tile & 0xfe) << 4) |
+			                  ((row & 0x08) << 1) | (row & 0x07);
+		} else {
+			object->Pattern = m_ObjectPage | (tile << 4) | row;
+		}
+		object->Flip = attribute & 0x40;
+		object->Flags = 0x10 | ((attribute & 0x03) << 2);
+		if (attribute & 0x20) {
+			object->Flags |= ppu::ObjectPixelBehind;
+		}
+		if (index == 0) {
+			object->Flags |= ppu::ObjectPixelZero;
+		}
+		object->X = m_OAM.X[index];
+	}
+	/**
+	 * Fetches found objects into object line buffer
+	 *
+	 * @param line Screen line to prepare
+	 * @param list Found objects
+	 */
+	void fetchObjects(int line, const ppu::SObjectList &list) {
+		m_ObjectZeroLine = -1;
+		if (line >= ppu::ScreenHeight) {
+			return;
+		}
+		std::uint8_t *buffer = m_ObjectBuffer + line * ppu::ScreenWidth;
+		std::memset(buffer, 0, ppu::ScreenWidth);
+		bool composed = isComposed();
+		bool deferred = isDeferred();
+		int count = isRenderingEnabled() ? list.Count : 0;
+		if (!composed && !deferred && count > 0) {
+			// Only object 0 is visible to the CPU
+			count = (list.Index[0] == 0) ? 1 : 0;
+		}
+		for (int slot = 0; slot < count; slot++) {
+			std::size_t index = list.Index[slot];
+			ppu::SLineObject object;
+			prepareObject(index, line, &object);
+			if (deferred) {
+				m_LineLog[line].Objects[slot] = object;
+			}
+			if (index == 0) {
+				m_ObjectZeroLine = line;
+			} else if (!composed) {
+				continue;
+			}
+			ppu::drawObject(
+			    getPatternRow(object.Pattern, object.Flip), object, buffer);
+		}
+		if (deferred) {
+			m_LineLog[line].ObjectCount = count;
+		}
+	}
+	/**
+	 * Composes logged lines
+	 *
+	 * Runs on worker threads.
+	 *
+	 * @param first First line
+	 * @param last Line after the last one
+	 * @param frame Frame buffer
+	 */
+	void composeLines(int first, int last, std::uint16_t *frame) {
+		std::uint8_t background[ppu::LinePixels];
+		std::uint8_t objects[ppu::ScreenWidth];
+		std::uint8_t pixels[ppu::TileWidth];
+		auto getRow = [this, &pixels](std::uint16_t pattern) {
+			readPatternRow(pattern, false, pixels);
+			return pixels;
+		};
+		for (int line = first; line < last; line++) {
+			const ppu::SLineState &state = m_LineLog[line];
+			std::memset(background, 0, sizeof(background));
+			if (state.BackgroundFirst < ppu::ScreenWidth) {
+				ppu::SBackgroundRow row{};
+				fetchBackground(
+				    state.Address, state.BackgroundPage, true, &row, getRow);
+				ppu::decodeBackground(row, background);
+			}
+			std::memset(objects, 0, sizeof(objects));
+			for (int slot = 0; slot < state.ObjectCount; slot++) {
+				const ppu::SLineObject &object = state.Objects[slot];
+				readPatternRow(object.Pattern, object.Flip, pixels);
+				ppu::drawObject(pixels, object, objects);
+			}
+			ppu::combinePixels(background + state.FineX, state.BackgroundFirst,
+			    objects, state.ObjectFirst, state.Colors,
+			    frame + line * ppu::ScreenWidth, 0, ppu::ScreenWidth);
+		}
+	}
+	/**
+	 * Logs render state of current line
+	 *
+	 * Passes the band to workers when its last line is logged.
+	 *
+	 * @param line Screen line
+	 */
+	void logLine(int line) {
+		ppu::SLineState &state = m_LineLog[line];
+		state.Address = m_Addr_v;
+		state.BackgroundPage = m_BackgroundPage;
+		state.FineX = getFineX();
+		state.BackgroundFirst = getBackgroundFirst();
+		state.ObjectFirst = getObjectFirst();
+		std::memcpy(state.Colors, m_Colors, sizeof(m_Colors));
+		if ((line + 1) % ppu::BandLines != 0 && line != ppu::ScreenHeight - 1) {
+			return;
+		}
+		int first = m_FirstPendingLine;
+		std::uint16_t *frame = m_FrameBuffer;
+		m_FirstPendingLine = line + 1;
+		m_Workers->addJob([this, first, line, frame]() {
+			composeLines(first, line + 1, frame);
+		});
+	}
+	/**
+	 * Waits for workers to compose passed lines
+	 *
+	 * Has to be called before VRAM changes.
+	 */
+	void finishLines() {
+		if (RenderMode::Deferred) {
+			m_Workers->wait();
+		}
+	}
+	/**
+	 * Renders current line
+	 */
+	void renderLine() {
+		int line = m_Scanline - ppu::ScanlineFirstVisible;
+		if (isDeferred()) {
+			logLine(line);
+		}
+		bool composed = isComposed();
+		if (!composed && (m_ObjectZeroLine != line || m_Object0Hit)) {
+			// Only object 0 hit is needed and the line can't produce it
+			return;
+		}
+		std::size_t offset = line * ppu::ScreenWidth;
+		if (m_EnableBackgound) {
+			decodeBackground(m_LineBuffer);
+		}
+		int hit;
+		if (composed) {
+			hit = ppu::combinePixels(m_LineBuffer + getFineX(),
+			    getBackgroundFirst(), m_ObjectBuffer + offset, getObjectFirst(),
+			    m_Colors, m_FrameBuffer + offset, 0, ppu::ScreenWidth);
+		} else {
+			hit = ppu::findObjectHit(m_LineBuffer + getFineX(),
+			    getBackgroundFirst(), m_ObjectBuffer + offset, getObjectFirst(),
+			    0, ppu::ScreenWidth);
+		}
+		if (hit >= 0 && !m_Object0Hit) {
+			m_HitDot = hit + 1;
+		}
+	}
+	/**
+	 * Gets dot of the next scanline step
+	 *
+	 * @param dot Current step
+	 * @return Next step
+	 */
+	int getNextStep(int dot) const {
+		if (m_Scanline == ppu::ScanlinePreRender) {
+			if (dot < PPUDotCopyHorizontal) {
+				return PPUDotCopyHorizontal;
+			} else if (dot < PPUDotCopyVertical) {
+				return PPUDotCopyVertical;
+			}
+			return ppu::LineDots;
+		}
+		int next = ppu::LineDots;
+		for (int step : {m_HitDot, static_cast<int>(PPUDotEvaluate),
+		         m_OverflowDot, static_cast<int>(PPUDotCopyHorizontal)}) {
+			if (step > dot && step < next) {
+				next = step;
+			}
+		}
+		return next;
+	}
+	/**
+	 * Performs next scanline step
+	 */
+	void stepScanline() {
+		int dot = m_LineDot;
+		if (dot == ppu::LineDots) {
+			m_LineClock += ppu::LineTime;
+			if (++m_Scanline == ppu::Scanlines) {
+				m_Scanline = ppu::ScanlinePreRender;
+			}
+			if (m_Scanline == ppu::ScanlinePreRender) {
+				m_LineDot = PPUDotCopyHorizontal;
+			} else if (m_Scanline < ppu::ScanlinePostRender) {
+				m_LineDot = PPUDotRender;
+			} else {
+				m_LineDot = ppu::LineDots;
+			}
+			return;
+		}
+		if (dot == PPUDotRender) {
+			renderLine();
+		}
+		if (m_HitDot && dot == m_HitDot) {
+			m_Object0Hit = PPUStateObject0Hit;
+			m_HitDot = 0;
+		}
+		if (dot == PPUDotEvaluate) {
+			evaluateObjects(m_Scanline, &m_LineObjects);
+			if (m_LineObjects.Overflow >= 0) {
+				m_OverflowDot = ppu::getOverflowDot(m_LineObjects.Overflow);
+			}
+		}
+		if (m_OverflowDot && dot == m_OverflowDot) {
+			m_ObjectOverflow = PPUStateObjectOberflow;
+			m_OverflowDot = 0;
+		}
+		if (dot == PPUDotCopyHorizontal) {
+			fetchObjects(m_Scanline, m_LineObjects);
+			m_LineObjects.Count = 0;
+			if (isRenderingEnabled()) {
+				if (m_Scanline != ppu::ScanlinePreRender) {
+					incrementY();
+				}
+				copyHorizontal();
+			}
+		}
+		if (dot == PPUDotCopyVertical && isRenderingEnabled()) {
+			copyVertical();
+		}
+		m_LineDot = getNextStep(dot);
 	}
 
+	/**
+	 * Handles start of vertical blank
+	 *
+	 * @param event Vertical blank event
+	 */
+	void handleVerticalBlank(CMotherBoard::CEvent *event) {
+		m_VBlankUnit.simulate(event->getFireTime());
+		if (m_GenerateNMI && m_VerticalBlank) {
+			m_CPU->triggerNMI();
+		}
+		event->setFireTime(event->getFireTime() + m_FrameTime);
+	}
 	/**
 	 * Handles frame ending
 	 *
 	 * @param event Frame ending event
 	 */
 	void handleFrameEnd(CMotherBoard::CEvent *event) {
+		if (!RenderMode::Scanline) {
+			m_MultiplexerUnit.simulate(event->getFireTime());
+		}
+		flushWrites();
+		finishLines();
+		m_FirstPendingLine = 0;
 		m_MotherBoard->getFrontEnd()->handleFrameRender(
 		    event->getFireTime() * m_Freq);
+		m_FrameBuffer = m_MotherBoard->getFrontEnd()->getFrameBuffer();
 		m_MotherBoard->resetClock(event->getFireTime());
 		event->setFireTime(m_FrameTime);
 	}
@@ -331,7 +1190,25 @@ protected:
 	 * Simulation routine
 	 */
 	void execute() {
-		// TODO(me): implement rendering
+		if (RenderMode::Scanline) {
+			while (m_LineClock + m_LineDot * ppu::DotTime <= m_Clock) {
+				stepScanline();
+			}
+		}
+		// Dot units are advanced on demand
+	}
+	/**
+	 * Resets the clock by ticks amount
+	 *
+	 * @param ticks Amount of ticks
+	 */
+	void resetClock(ticks_t ticks) {
+		CEventDevice::resetClock(ticks);
+		m_LineClock -= ticks;
+		m_VBlankUnit.resetClock(ticks);
+		m_BackgroundUnit.resetClock(ticks);
+		m_ObjectUnit.resetClock(ticks);
+		m_MultiplexerUnit.resetClock(ticks);
 	}
 
 public:
@@ -343,15 +1220,40 @@ public:
 	 * Constructs the object
 	 *
 	 * @param motherBoard Motherboard
+	 * @param cpu CPU
 	 * @param frequency Frequency
 	 * @param frameTime Basic frame time
 	 */
-	CPPU(CMotherBoard *motherBoard, double frequency, std::size_t frameTime)
+	CPPU(CMotherBoard *motherBoard, CCPU *cpu, double frequency,
+	    std::size_t frameTime)
 	    : CEventDevice()
 	    , m_MotherBoard(motherBoard)
+	    , m_CPU(cpu)
+	    , m_Palette{}
+	    , m_Colors{}
 	    , m_IOBuf()
 	    , m_FrameTime(frameTime)
 	    , m_Freq(frequency)
+	    , m_LineClock(0)
+	    , m_Scanline(ppu::ScanlinePreRender)
+	    , m_LineDot(PPUDotCopyHorizontal)
+	    , m_LineBuffer{}
+	    , m_FrameBuffer(motherBoard->getFrontEnd()->getFrameBuffer())
+	    , m_BackgroundBuffer{}
+	    , m_ObjectBuffer{}
+	    , m_OAM()
+	    , m_OAMAddr(0)
+	    , m_LineObjects()
+	    , m_HitDot(0)
+	    , m_OverflowDot(0)
+	    , m_ObjectZeroLine(-1)
+	    , m_TileCache(new ppu::CTileCache())
+	    , m_Tiles(m_TileCache.get())
+	    , m_BackgroundCache()
+	    , m_VBlankUnit(this)
+	    , m_BackgroundUnit(this)
+	    , m_ObjectUnit(this)
+	    , m_MultiplexerUnit(this)
 	    , m_Addr_v(0)
 	    , m_Addr_t(0)
 	    , m_BackgroundPage(0)
@@ -369,7 +1271,22 @@ public:
 	    , m_Object0Hit(0)
 	    , m_ObjectOverflow(0)
 	    , m_VerticalBlank(0)
-	    , m_WriteTrigger(false) {
+	    , m_WriteTrigger(false)
+	    , m_ReadBuffer(0)
+	    , m_Upload()
+	    , m_UploadAddr(0)
+	    , m_UploadSize(0)
+	    , m_LineLog()
+	    , m_FirstPendingLine(0)
+	    , m_Workers() {
+		if (RenderMode::Deferred) {
+			std::size_t threads = std::thread::hardware_concurrency();
+			// Emulation keeps one core busy
+			m_Workers.reset(new CWorkerPool((threads > 2) ? threads - 1 : 1));
+		}
+		m_MotherBoard->registerEvent(this, m_MotherBoard, "PPU_VERTICAL_BLANK",
+		    ppu::ScanlineVBlank * ppu::LineTime + ppu::DotTime, true,
+		    &CPPU::handleVerticalBlank);
 		m_MotherBoard->registerEvent(this, m_MotherBoard, "FRAME_RENDER_END",
 		    m_FrameTime, true, &CPPU::handleFrameEnd);
 	}
@@ -388,6 +1305,7 @@ public:
 			bus->addPreReadHook(addr, this, &CPPU::readReg);
 			bus->addWriteHook(addr, this, &CPPU::writeReg);
 		}
+		bus->addWriteHook(0x4014, this, &CPPU::writeDMA);
 	}
 	/**
 	 * Adds PPU hooks
@@ -395,6 +1313,26 @@ public:
 	 * @param bus PPU bus
 	 */
 	void addHooksPPU(CBus *bus) {
+		for (std::uint16_t addr = 0x0000; addr < 0x2000; addr++) {
+			bus->addWriteHook(addr, this, &CPPU::writePattern);
+		}
+		for (std::uint16_t addr = 0x2000; addr < 0x3f00; addr++) {
+			bus->addWriteHook(addr, this, &CPPU::writeNameTable);
+		}
+	}
+	/**
+	 * Uses pattern tables decoded by the mapper
+	 *
+	 * Pattern ROM ignores writes, so the tiles are never dropped and the
+	 * own cache is released.
+	 *
+	 * @param tiles Decoded pattern tables (nullptr for pattern RAM)
+	 */
+	void setTiles(const ppu::CTileCache *tiles) {
+		if (tiles) {
+			m_TileCache.reset();
+			m_Tiles = tiles;
+		}
 	}
 
 	/**
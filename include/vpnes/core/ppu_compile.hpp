@@ -1,6 +1,6 @@
 /**
  * @file
- * Defines microcode compilation helpers for ppu
+ * Defines clocked units for ppu
  */
 /*
  NES Emulator
@@ -29,9 +29,13 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/device.hpp>
-#include <vpnes/core/ppu.hpp>
+#include <vpnes/core/bus.hpp>
+#include <vpnes/core/ppu_render.hpp>
 
 namespace vpnes {
 
@@ -39,26 +43,86 @@ namespace core {
 
 namespace ppu {
 
+/**
+ * Frame timings
+ */
+enum {
+	DotTime = 4,                            //!< Ticks per dot
+	LineDots = 341,                         //!< Dots per scanline
+	LineTime = DotTime * LineDots,          //!< Ticks per scanline
+	ScanlinePreRender = 0,                  //!< Pre-render scanline
+	ScanlineFirstVisible = 1,               //!< First visible scanline
+	ScanlinePostRender = 1 + ScreenHeight,  //!< Post-render scanline
+	ScanlineVBlank = 2 + ScreenHeight,      //!< First vertical blank scanline
+	Scanlines = 262,                        //!< Total scanlines
+	ObjectEvaluateDot = 65,                 //!< Start of object evaluation
+	ObjectFetchDot = 257                    //!< Start of object fetch
+};
+
+/**
+ * Gets dot when object overflow is detected
+ *
+ * @param index OAM index of the first object over the limit
+ * @return Dot of the line
+ */
+inline int getOverflowDot(int index) {
+	// Each copied object takes 6 more dots than a skipped one
+	return ObjectEvaluateDot + 1 + index * 2 + LineObjects * 6;
+}
+
 /**
  * PPU Unit
  */
+template <class PPU>
 class CPPUUnit : public CClockedDevice {
 protected:
 	/**
 	 * Link to PPU
 	 */
-	CPPU *m_PPU;
+	PPU *m_PPU;
 	/**
-	 * Internal clock
+	 * Internal clock (time of the next dot)
 	 */
 	ticks_t m_InternalClock;
 	/**
-	 * Resets the clock by ticks amount
+	 * Scanline of the next dot
+	 */
+	int m_Scanline;
+	/**
+	 * Next dot
+	 */
+	int m_Dot;
+
+	/**
+	 * Checks if next dot is reached
 	 *
-	 * @param ticks Amount of ticks
+	 * @return True if can execute
 	 */
-	void resetClock(ticks_t ticks) {
-		m_InternalClock -= ticks;
+	bool isReady() const {
+		return m_InternalClock <= m_Clock;
+	}
+	/**
+	 * Gets amount of dots that can be executed
+	 *
+	 * @return Amount of dots
+	 */
+	int getReadyDots() const {
+		return static_cast<int>((m_Clock - m_InternalClock) / DotTime) + 1;
+	}
+	/**
+	 * Skips dots
+	 *
+	 * @param dots Amount of dots
+	 */
+	void skipDots(int dots) {
+		m_InternalClock += dots * DotTime;
+		m_Dot += dots;
+		while (m_Dot >= LineDots) {
+			m_Dot -= LineDots;
+			if (++m_Scanline == Scanlines) {
+				m_Scanline = ScanlinePreRender;
+			}
+		}
 	}
 
 public:
@@ -71,13 +135,26 @@ public:
 	 *
 	 * @param ppu PPU
 	 */
-	explicit CPPUUnit(CPPU *&ppu) : m_PPU(ppu), m_InternalClock() {
+	explicit CPPUUnit(PPU *ppu)
+	    : m_PPU(ppu)
+	    , m_InternalClock()
+	    , m_Scanline(ScanlinePreRender)
+	    , m_Dot(0) {
 	}
 	/**
 	 * Default destructor
 	 */
 	~CPPUUnit() = default;
 
+	/**
+	 * Resets the clock by ticks amount
+	 *
+	 * @param ticks Amount of ticks
+	 */
+	void resetClock(ticks_t ticks) {
+		CClockedDevice::resetClock(ticks);
+		m_InternalClock -= ticks;
+	}
 	/**
 	 * Gets pending time
 	 *
@@ -96,6 +173,363 @@ public:
 	}
 };
 
+/**
+ * Vertical blank and NMI timing
+ *
+ * Only walks between the edges of vertical blank.
+ */
+template <class PPU>
+class CVBlankUnit : public CPPUUnit<PPU> {
+protected:
+	/**
+	 * Simulation routine
+	 */
+	void execute() {
+		while (this->isReady()) {
+			if (this->m_Scanline == ScanlineVBlank) {
+				this->m_PPU->m_VerticalBlank = PPU::PPUStateVerticalBlank;
+				this->skipDots((Scanlines - ScanlineVBlank) * LineDots);
+			} else {
+				this->m_PPU->m_VerticalBlank = 0;
+				this->m_PPU->m_Object0Hit = 0;
+				this->m_PPU->m_ObjectOverflow = 0;
+				this->skipDots(ScanlineVBlank * LineDots);
+			}
+		}
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param ppu PPU
+	 */
+	explicit CVBlankUnit(PPU *ppu) : CPPUUnit<PPU>(ppu) {
+		this->skipDots(1);
+	}
+};
+
+/**
+ * Background fetcher
+ *
+ * Runs the fetch pipeline and the shift registers dot by dot and stores
+ * background pixels for the pixel multiplexer.
+ */
+template <class PPU>
+class CBackgroundUnit : public CPPUUnit<PPU> {
+private:
+	/**
+	 * Fetched tile index
+	 */
+	std::uint8_t m_Tile;
+	/**
+	 * Fetched palette bits
+	 */
+	std::uint8_t m_Attribute;
+	/**
+	 * Fetched low bit plane
+	 */
+	std::uint8_t m_Low;
+	/**
+	 * Fetched high bit plane
+	 */
+	std::uint8_t m_High;
+	/**
+	 * Low pattern shift register
+	 */
+	std::uint16_t m_ShiftLow;
+	/**
+	 * High pattern shift register
+	 */
+	std::uint16_t m_ShiftHigh;
+	/**
+	 * Low palette shift register
+	 */
+	std::uint16_t m_ShiftAttributeLow;
+	/**
+	 * High palette shift register
+	 */
+	std::uint16_t m_ShiftAttributeHigh;
+
+	/**
+	 * Reloads shift registers with fetched tile
+	 */
+	void reload() {
+		m_ShiftLow = (m_ShiftLow & 0xff00) | m_Low;
+		m_ShiftHigh = (m_ShiftHigh & 0xff00) | m_High;
+		m_ShiftAttributeLow =
+		    (m_ShiftAttributeLow & 0xff00) | ((m_Attribute & 0x01) ? 0xff : 0);
+		m_ShiftAttributeHigh =
+		    (m_ShiftAttributeHigh & 0xff00) | ((m_Attribute & 0x02) ? 0xff : 0);
+	}
+	/**
+	 * Fetches the tile data
+	 *
+	 * @param dot Current dot
+	 */
+	void fetch(int dot) {
+		PPU *ppu = this->m_PPU;
+		CBus *bus = ppu->m_MotherBoard->getBusPPU();
+		std::uint16_t addr = ppu->m_Addr_v;
+		switch (dot & 0x07) {
+		case 1:
+			if (dot != 1 && dot != 321) {
+				reload();
+			}
+			m_Tile = bus->readMemory(0x2000 | (addr & 0x0fff));
+			break;
+		case 3:
+			m_Attribute =
+			    bus->readMemory(0x23c0 | (addr & 0x0c00) |
+			                    ((addr >> 4) & 0x38) | ((addr >> 2) & 0x07));
+			m_Attribute >>= ((addr >> 4) & 0x04) | (addr & 0x02);
+			break;
+		case 5:
+			m_Low = bus->readMemory(
+			    ppu->m_BackgroundPage | (m_Tile << 4) | (addr >> 12));
+			break;
+		case 7:
+			m_High = bus->readMemory(
+			    ppu->m_BackgroundPage | (m_Tile << 4) | (addr >> 12) | 0x08);
+			break;
+		case 0:
+			ppu->incrementX();
+			break;
+		}
+	}
+	/**
+	 * Processes next dot
+	 */
+	void processDot() {
+		PPU *ppu = this->m_PPU;
+		int dot = this->m_Dot;
+		bool visible = this->m_Scanline != ScanlinePreRender;
+		if ((dot >= 2 && dot <= 257) || (dot >= 322 && dot <= 337)) {
+			m_ShiftLow <<= 1;
+			m_ShiftHigh <<= 1;
+			m_ShiftAttributeLow <<= 1;
+			m_ShiftAttributeHigh <<= 1;
+		}
+		if ((dot >= 1 && dot <= 256) || (dot >= 321 && dot <= 336)) {
+			fetch(dot);
+		} else if (dot == 257 || dot == 337) {
+			reload();
+		}
+		if (dot == 256) {
+			ppu->incrementY();
+		} else if (dot == 257) {
+			ppu->copyHorizontal();
+		} else if (!visible && dot >= 280 && dot <= 304) {
+			ppu->copyVertical();
+		}
+		if (visible && dot >= 1 && dot <= ScreenWidth) {
+			std::uint16_t bit = 0x8000 >> ppu->getFineX();
+			std::uint8_t pixel = ((m_ShiftLow & bit) ? 0x01 : 0) |
+			                     ((m_ShiftHigh & bit) ? 0x02 : 0);
+			if (pixel) {
+				pixel |= ((m_ShiftAttributeLow & bit) ? 0x04 : 0) |
+				         ((m_ShiftAttributeHigh & bit) ? 0x08 : 0);
+			}
+			ppu->m_BackgroundBuffer[(this->m_Scanline - ScanlineFirstVisible) *
+			                            ScreenWidth +
+			                        dot - 1] = pixel;
+		}
+	}
+
+protected:
+	/**
+	 * Simulation routine
+	 */
+	void execute() {
+		while (this->isReady()) {
+			if (this->m_Scanline >= ScanlinePostRender ||
+			    !this->m_PPU->isRenderingEnabled()) {
+				int dots = LineDots - this->m_Dot;
+				int readyDots = this->getReadyDots();
+				this->skipDots((dots < readyDots) ? dots : readyDots);
+				continue;
+			}
+			processDot();
+			this->skipDots(1);
+		}
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param ppu PPU
+	 */
+	explicit CBackgroundUnit(PPU *ppu)
+	    : CPPUUnit<PPU>(ppu)
+	    , m_Tile()
+	    , m_Attribute()
+	    , m_Low()
+	    , m_High()
+	    , m_ShiftLow()
+	    , m_ShiftHigh()
+	    , m_ShiftAttributeLow()
+	    , m_ShiftAttributeHigh() {
+	}
+};
+
+/**
+ * Sprite evaluator
+ *
+ * Evaluates sprites of the next line and composes them into object line
+ * buffer for the pixel multiplexer. Steps only on evaluation, overflow and
+ * fetch dots.
+ */
+template <class PPU>
+class CObjectUnit : public CPPUUnit<PPU> {
+private:
+	/**
+	 * Objects found for the next line
+	 */
+	SObjectList m_Objects;
+	/**
+	 * Dot when overflow is detected (0 if none)
+	 */
+	int m_OverflowDot;
+
+	/**
+	 * Gets dot of the next step
+	 *
+	 * @return Next step
+	 */
+	int getNextStep() const {
+		int dot = this->m_Dot;
+		if (this->m_Scanline >= ScanlinePostRender) {
+			return LineDots;
+		}
+		if (this->m_Scanline != ScanlinePreRender && dot <= ObjectEvaluateDot) {
+			return ObjectEvaluateDot;
+		}
+		if (m_OverflowDot && dot <= m_OverflowDot) {
+			return m_OverflowDot;
+		}
+		if (dot <= ObjectFetchDot) {
+			return ObjectFetchDot;
+		}
+		return LineDots;
+	}
+
+protected:
+	/**
+	 * Simulation routine
+	 */
+	void execute() {
+		while (this->isReady()) {
+			int dots = getNextStep() - this->m_Dot;
+			int readyDots = this->getReadyDots();
+			if (dots >= readyDots) {
+				this->skipDots(readyDots);
+				break;
+			}
+			this->skipDots(dots);
+			if (this->m_Dot == 0) {
+				continue;
+			}
+			if (this->m_Dot == ObjectEvaluateDot) {
+				this->m_PPU->evaluateObjects(this->m_Scanline, &m_Objects);
+				if (m_Objects.Overflow >= 0) {
+					m_OverflowDot = getOverflowDot(m_Objects.Overflow);
+				}
+			} else if (this->m_Dot == m_OverflowDot) {
+				this->m_PPU->m_ObjectOverflow = PPU::PPUStateObjectOberflow;
+				m_OverflowDot = 0;
+			} else {
+				this->m_PPU->fetchObjects(this->m_Scanline, m_Objects);
+				m_Objects.Count = 0;
+			}
+			this->skipDots(1);
+		}
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param ppu PPU
+	 */
+	explicit CObjectUnit(PPU *ppu)
+	    : CPPUUnit<PPU>(ppu), m_Objects(), m_OverflowDot() {
+	}
+};
+
+/**
+ * Pixel multiplexer
+ *
+ * Combines background and object pixels into the frame and detects
+ * object 0 hit. Pulls the fetchers up to its own position.
+ */
+template <class PPU>
+class CMultiplexerUnit : public CPPUUnit<PPU> {
+private:
+	/**
+	 * Combines pixels of current line
+	 *
+	 * @param first First dot
+	 * @param last Last dot
+	 */
+	void combine(int first, int last) {
+		PPU *ppu = this->m_PPU;
+		std::size_t offset =
+		    (this->m_Scanline - ScanlineFirstVisible) * ScreenWidth;
+		int hit;
+		if (ppu->m_FrameBuffer) {
+			hit = combinePixels(ppu->m_BackgroundBuffer + offset,
+			    ppu->getBackgroundFirst(), ppu->m_ObjectBuffer + offset,
+			    ppu->getObjectFirst(), ppu->m_Colors,
+			    ppu->m_FrameBuffer + offset, first - 1, last);
+		} else {
+			hit = findObjectHit(ppu->m_BackgroundBuffer + offset,
+			    ppu->getBackgroundFirst(), ppu->m_ObjectBuffer + offset,
+			    ppu->getObjectFirst(), first - 1, last);
+		}
+		if (hit >= 0) {
+			ppu->m_Object0Hit = PPU::PPUStateObject0Hit;
+		}
+	}
+
+protected:
+	/**
+	 * Simulation routine
+	 */
+	void execute() {
+		while (this->isReady()) {
+			int readyDots = this->getReadyDots();
+			if (this->m_Scanline < ScanlineFirstVisible ||
+			    this->m_Scanline >= ScanlinePostRender || this->m_Dot == 0 ||
+			    this->m_Dot > ScreenWidth) {
+				int dots = (this->m_Dot == 0) ? 1 : (LineDots - this->m_Dot);
+				this->skipDots((dots < readyDots) ? dots : readyDots);
+				continue;
+			}
+			int first = this->m_Dot;
+			int last = first + readyDots - 1;
+			if (last > ScreenWidth) {
+				last = ScreenWidth;
+			}
+			this->m_InternalClock += (last - first) * DotTime;
+			this->m_PPU->m_BackgroundUnit.resolveDependency(*this);
+			this->m_PPU->m_ObjectUnit.resolveDependency(*this);
+			combine(first, last);
+			this->m_InternalClock -= (last - first) * DotTime;
+			this->skipDots(last - first + 1);
+		}
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param ppu PPU
+	 */
+	explicit CMultiplexerUnit(PPU *ppu) : CPPUUnit<PPU>(ppu) {
+	}
+};
+
 }  // namespace ppu
 
 }  // namespace core
@@ -0,0 +1,713 @@
+/**
+ * @file
+ * Defines rendering helpers for ppu
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifndef INCLUDE_VPNES_CORE_PPU_RENDER_HPP_
+#define INCLUDE_VPNES_CORE_PPU_RENDER_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <vpnes/vpnes.hpp>
+
+#ifdef VPNES_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace vpnes {
+
+namespace core {
+
+namespace ppu {
+
+/**
+ * Screen geometry
+ */
+enum {
+	ScreenWidth = 256,   //!< Visible pixels per line
+	ScreenHeight = 240,  //!< Visible lines
+	TileWidth = 8,       //!< Pixels per tile
+	LineTiles = 33,      //!< Tiles fetched per line (32 + 1 for fine X)
+	FetchTiles = 48,     //!< Fetched tiles rounded up to decoding step
+	LinePixels = FetchTiles * TileWidth,  //!< Size of decoded line
+	Objects = 64,                         //!< Objects in OAM
+	LineObjects = 8                       //!< Objects shown per line
+};
+
+/**
+ * Flags of object line pixels
+ */
+enum {
+	ObjectPixelBehind = 0x20,  //!< Object is behind background
+	ObjectPixelZero = 0x40     //!< Pixel belongs to object 0
+};
+
+/**
+ * Background row fetched for one scanline
+ */
+struct SBackgroundRow {
+	/**
+	 * Pixels of fetched tiles without palette bits
+	 */
+	std::uint8_t Pixels[LinePixels];
+	/**
+	 * Palette bits (pre-shifted to bits 2-3)
+	 */
+	std::uint8_t Palette[FetchTiles];
+};
+
+/**
+ * Spreads bits of a bit plane into bytes (MSB is the leftmost pixel)
+ *
+ * @return Table of spread bytes
+ */
+constexpr std::array<std::array<std::uint8_t, TileWidth>, 256> makeSpread() {
+	std::array<std::array<std::uint8_t, TileWidth>, 256> table{};
+	for (std::size_t plane = 0; plane < 256; plane++) {
+		for (std::size_t pixel = 0; pixel < TileWidth; pixel++) {
+			table[plane][pixel] = (plane >> (7 - pixel)) & 1;
+		}
+	}
+	return table;
+}
+
+/**
+ * Decodes one tile row into 2-bit pixels
+ *
+ * @param low Low bit plane
+ * @param high High bit plane
+ * @param line Output pixels
+ */
+inline void decodeTile(std::uint8_t low, std::uint8_t high, std::uint8_t *line) {
+	static constexpr auto spread = makeSpread();
+	std::uint64_t pixels, highPixels;
+	std::memcpy(&pixels, spread[low].data(), sizeof(pixels));
+	std::memcpy(&highPixels, spread[high].data(), sizeof(highPixels));
+	// Bytes are 0 or 1, so the shift does not carry
+	pixels |= highPixels << 1;
+	std::memcpy(line, &pixels, sizeof(pixels));
+}
+
+/**
+ * Adds palette bits to opaque pixels of one tile
+ *
+ * @param pixels 2-bit pixels
+ * @param palette Palette bits
+ * @param line Output pixels
+ */
+inline void colorTile(
+    const std::uint8_t *pixels, std::uint8_t palette, std::uint8_t *line) {
+	std::uint64_t color, opaque;
+	std::memcpy(&color, pixels, sizeof(color));
+	opaque = (color | (color >> 1)) & 0x0101010101010101ull;
+	// Opaque bytes are 0 or 1, so the multiplication does not carry
+	color |= opaque * palette;
+	std::memcpy(line, &color, sizeof(color));
+}
+
+#ifdef VPNES_SSE2
+/**
+ * Broadcasts each of 16 bytes into 8 bytes
+ *
+ * @param src Source bytes
+ * @param dest Two tiles per register
+ */
+inline void broadcastTiles(__m128i src, __m128i *dest) {
+	__m128i x2[2] = {_mm_unpacklo_epi8(src, src), _mm_unpackhi_epi8(src, src)};
+	for (int i = 0; i < 2; i++) {
+		__m128i x4lo = _mm_unpacklo_epi16(x2[i], x2[i]);
+		__m128i x4hi = _mm_unpackhi_epi16(x2[i], x2[i]);
+		dest[i * 4 + 0] = _mm_unpacklo_epi32(x4lo, x4lo);
+		dest[i * 4 + 1] = _mm_unpackhi_epi32(x4lo, x4lo);
+		dest[i * 4 + 2] = _mm_unpacklo_epi32(x4hi, x4hi);
+		dest[i * 4 + 3] = _mm_unpackhi_epi32(x4hi, x4hi);
+	}
+}
+#endif
+
+/**
+ * Decodes fetched background row into palette indices
+ *
+ * Transparent pixels are set to 0.
+ *
+ * @param row Fetched row
+ * @param line Output line (LinePixels bytes)
+ */
+inline void decodeBackground(const SBackgroundRow &row, std::uint8_t *line) {
+#ifdef VPNES_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (std::size_t tile = 0; tile < FetchTiles; tile += 16) {
+		__m128i palette[8];
+		broadcastTiles(_mm_loadu_si128(
+		                   reinterpret_cast<const __m128i *>(row.Palette + tile)),
+		    palette);
+		for (int i = 0; i < 8; i++) {
+			std::size_t offset = (tile + i * 2) * TileWidth;
+			__m128i pixels = _mm_loadu_si128(
+			    reinterpret_cast<const __m128i *>(row.Pixels + offset));
+			pixels = _mm_or_si128(pixels,
+			    _mm_andnot_si128(_mm_cmpeq_epi8(pixels, zero), palette[i]));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(line + offset), pixels);
+		}
+	}
+#else
+	for (std::size_t tile = 0; tile < LineTiles; tile++) {
+		colorTile(row.Pixels + tile * TileWidth, row.Palette[tile],
+		    line + tile * TileWidth);
+	}
+#endif
+}
+
+/**
+ * Pre-decoded pattern tables
+ *
+ * Keeps every tile of the pattern tables split into 2-bit pixels, both as
+ * stored and horizontally flipped. Tiles are decoded on first use and
+ * dropped on writes to their pattern bytes. CHR ROM is decoded at once and
+ * shared through its image (see CROMImage::getTiles).
+ */
+class CTileCache {
+public:
+	/**
+	 * Cache geometry
+	 */
+	enum {
+		Tiles = 0x0200,   //!< Tiles in pattern tables
+		TileRows = 8,     //!< Rows per tile
+		TileSize = 0x10   //!< Bytes per tile
+	};
+
+private:
+	/**
+	 * Decoded rows (as stored and flipped)
+	 */
+	std::uint8_t m_Rows[2][Tiles][TileRows][TileWidth];
+	/**
+	 * Valid tiles
+	 */
+	bool m_Valid[Tiles];
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CTileCache() : m_Rows(), m_Valid() {
+	}
+
+	/**
+	 * Checks if the tile is decoded
+	 *
+	 * @param addr Pattern address
+	 * @return True if decoded
+	 */
+	bool isValid(std::uint16_t addr) const {
+		return m_Valid[(addr >> 4) & (Tiles - 1)];
+	}
+	/**
+	 * Decodes the tile
+	 *
+	 * @param addr Pattern address
+	 * @param planes Pattern bytes of the tile
+	 */
+	void update(std::uint16_t addr, const std::uint8_t *planes) {
+		std::size_t tile = (addr >> 4) & (Tiles - 1);
+		for (std::size_t row = 0; row < TileRows; row++) {
+			std::uint8_t *pixels = m_Rows[0][tile][row];
+			std::uint8_t *flipped = m_Rows[1][tile][row];
+			decodeTile(planes[row], planes[row + TileRows], pixels);
+			for (std::size_t pixel = 0; pixel < TileWidth; pixel++) {
+				flipped[pixel] = pixels[TileWidth - 1 - pixel];
+			}
+		}
+		m_Valid[tile] = true;
+	}
+	/**
+	 * Decodes all tiles
+	 *
+	 * @param patterns Pattern tables (Tiles * TileSize bytes)
+	 */
+	void updateAll(const std::uint8_t *patterns) {
+		for (std::size_t tile = 0; tile < Tiles; tile++) {
+			update(static_cast<std::uint16_t>(tile << 4),
+			    patterns + tile * TileSize);
+		}
+	}
+	/**
+	 * Drops the tile containing the address
+	 *
+	 * @param addr Pattern address
+	 */
+	void invalidate(std::uint16_t addr) {
+		m_Valid[(addr >> 4) & (Tiles - 1)] = false;
+	}
+	/**
+	 * Drops all tiles
+	 */
+	void invalidateAll() {
+		std::memset(m_Valid, 0, sizeof(m_Valid));
+	}
+	/**
+	 * Gets decoded row
+	 *
+	 * @param addr Pattern address of the row
+	 * @param flip Flip horizontally
+	 * @return Pixels of the row
+	 */
+	const std::uint8_t *getRow(std::uint16_t addr, bool flip) const {
+		return m_Rows[flip][(addr >> 4) & (Tiles - 1)][addr & (TileRows - 1)];
+	}
+};
+
+/**
+ * Decoded background rows of nametables
+ *
+ * Keeps whole 32-tile rows decoded with palette bits, so a line is
+ * assembled from two rows for any horizontal scroll. Rows are decoded on
+ * first use and dropped on writes to their nametable bytes. Mirroring is
+ * not known here, so a write drops the row in every nametable.
+ */
+class CBackgroundCache {
+public:
+	/**
+	 * Cache geometry
+	 */
+	enum {
+		NameTables = 4,  //!< Nametables on the bus
+		Rows = 32,       //!< Coarse Y values
+		RowLines = 8     //!< Fine Y values
+	};
+
+private:
+	/**
+	 * Decoded lines
+	 */
+	std::uint8_t m_Lines[NameTables][Rows][RowLines][ScreenWidth];
+	/**
+	 * Pattern pages of decoded lines
+	 */
+	std::uint16_t m_Pages[NameTables][Rows][RowLines];
+	/**
+	 * Valid lines
+	 */
+	bool m_Valid[NameTables][Rows][RowLines];
+
+	/**
+	 * Drops a row in every nametable
+	 *
+	 * @param row Coarse Y
+	 */
+	void invalidateRow(std::size_t row) {
+		for (std::size_t nameTable = 0; nameTable < NameTables; nameTable++) {
+			std::memset(m_Valid[nameTable][row], 0, RowLines);
+		}
+	}
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CBackgroundCache() : m_Lines(), m_Pages(), m_Valid() {
+	}
+
+	/**
+	 * Checks if the line is decoded
+	 *
+	 * @param addr VRAM address of the line
+	 * @param page Background pattern page
+	 * @return True if decoded
+	 */
+	bool isValid(std::uint16_t addr, std::uint16_t page) const {
+		std::size_t nameTable = (addr >> 10) & 0x03;
+		std::size_t row = (addr >> 5) & 0x1f;
+		std::size_t fineY = (addr >> 12) & 0x07;
+		return m_Valid[nameTable][row][fineY] &&
+		       m_Pages[nameTable][row][fineY] == page;
+	}
+	/**
+	 * Stores decoded line
+	 *
+	 * @param addr VRAM address of the line
+	 * @param page Background pattern page
+	 * @param line Decoded line starting with coarse X 0
+	 */
+	void update(
+	    std::uint16_t addr, std::uint16_t page, const std::uint8_t *line) {
+		std::size_t nameTable = (addr >> 10) & 0x03;
+		std::size_t row = (addr >> 5) & 0x1f;
+		std::size_t fineY = (addr >> 12) & 0x07;
+		std::memcpy(m_Lines[nameTable][row][fineY], line, ScreenWidth);
+		m_Pages[nameTable][row][fineY] = page;
+		m_Valid[nameTable][row][fineY] = true;
+	}
+	/**
+	 * Drops lines using nametable byte
+	 *
+	 * @param addr Address of the byte
+	 */
+	void invalidate(std::uint16_t addr) {
+		std::size_t offset = addr & 0x03ff;
+		// Tile indices (also attributes when coarse Y is 30 or 31)
+		invalidateRow(offset >> 5);
+		if (offset >= 0x03c0) {
+			std::size_t first = ((offset >> 3) & 0x07) << 2;
+			for (std::size_t row = first; row < first + 4; row++) {
+				invalidateRow(row);
+			}
+		}
+	}
+	/**
+	 * Drops all lines
+	 */
+	void invalidateAll() {
+		std::memset(m_Valid, 0, sizeof(m_Valid));
+	}
+	/**
+	 * Gets decoded line
+	 *
+	 * @param addr VRAM address of the line
+	 * @return Pixels of the line starting with coarse X 0
+	 */
+	const std::uint8_t *getLine(std::uint16_t addr) const {
+		return m_Lines[(addr >> 10) & 0x03][(addr >> 5) & 0x1f]
+		              [(addr >> 12) & 0x07];
+	}
+};
+
+/**
+ * Object attribute memory split into arrays of fields
+ */
+struct SObjectMemory {
+	/**
+	 * Y coordinates (line before the first one)
+	 */
+	std::uint8_t Y[Objects];
+	/**
+	 * Tile indices
+	 */
+	std::uint8_t Tile[Objects];
+	/**
+	 * Attributes
+	 */
+	std::uint8_t Attribute[Objects];
+	/**
+	 * X coordinates
+	 */
+	std::uint8_t X[Objects];
+
+	/**
+	 * Reads OAM byte
+	 *
+	 * @param addr OAM address
+	 * @return Value
+	 */
+	std::uint8_t read(std::uint8_t addr) const {
+		const std::uint8_t *fields[] = {Y, Tile, Attribute, X};
+		return fields[addr & 0x03][addr >> 2];
+	}
+	/**
+	 * Writes OAM byte
+	 *
+	 * @param addr OAM address
+	 * @param val Value
+	 */
+	void write(std::uint8_t addr, std::uint8_t val) {
+		std::uint8_t *fields[] = {Y, Tile, Attribute, X};
+		if ((addr & 0x03) == 0x02) {
+			// Attribute bits 2-4 are not implemented in hardware
+			val &= 0xe3;
+		}
+		fields[addr & 0x03][addr >> 2] = val;
+	}
+	/**
+	 * Loads whole OAM
+	 *
+	 * @param data 256 bytes in OAM order
+	 * @param addr OAM address of the first byte
+	 */
+	void load(const std::uint8_t *data, std::uint8_t addr) {
+		std::uint8_t memory[Objects * 4];
+		std::memcpy(memory + addr, data, sizeof(memory) - addr);
+		std::memcpy(memory, data + sizeof(memory) - addr, addr);
+		for (std::size_t index = 0; index < Objects; index++) {
+			Y[index] = memory[index * 4];
+			Tile[index] = memory[index * 4 + 1];
+			Attribute[index] = memory[index * 4 + 2] & 0xe3;
+			X[index] = memory[index * 4 + 3];
+		}
+	}
+};
+
+/**
+ * Objects found for one line
+ */
+struct SObjectList {
+	/**
+	 * OAM indices in priority order
+	 */
+	std::uint8_t Index[LineObjects];
+	/**
+	 * Amount of found objects
+	 */
+	int Count;
+	/**
+	 * OAM index of the first object over the limit (-1 if none)
+	 */
+	int Overflow;
+};
+
+/**
+ * Finds objects covering the line
+ *
+ * @param oam Object attribute memory
+ * @param line Screen line (objects are never evaluated for line 0)
+ * @param height Object height
+ * @return Bit mask of found objects
+ */
+inline std::uint64_t findObjects(
+    const SObjectMemory &oam, int line, int height) {
+	std::uint64_t mask = 0;
+	// Object covers the line when 0 <= line - 1 - Y < height
+#ifdef VPNES_SSE2
+	const __m128i current = _mm_set1_epi8(static_cast<char>(line - 1));
+	const __m128i lastRow = _mm_set1_epi8(static_cast<char>(height - 1));
+	for (std::size_t index = 0; index < Objects; index += 16) {
+		__m128i y =
+		    _mm_loadu_si128(reinterpret_cast<const __m128i *>(oam.Y + index));
+		__m128i row = _mm_sub_epi8(current, y);
+		__m128i found = _mm_and_si128(
+		    _mm_cmpeq_epi8(_mm_min_epu8(y, current), y),
+		    _mm_cmpeq_epi8(_mm_min_epu8(row, lastRow), row));
+		mask |= static_cast<std::uint64_t>(
+		            static_cast<std::uint16_t>(_mm_movemask_epi8(found)))
+		        << index;
+	}
+#else
+	for (std::size_t index = 0; index < Objects; index++) {
+		int row = line - 1 - oam.Y[index];
+		if (row >= 0 && row < height) {
+			mask |= static_cast<std::uint64_t>(1) << index;
+		}
+	}
+#endif
+	return mask;
+}
+
+/**
+ * Gets index of the lowest set bit
+ *
+ * @param mask Non-zero mask
+ * @return Bit index
+ */
+inline int getLowestBit(std::uint64_t mask) {
+	static constexpr std::uint8_t table[] = {0, 1, 48, 2, 57, 49, 28, 3, 61,
+	    58, 50, 42, 38, 29, 17, 4, 62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33,
+	    30, 24, 18, 12, 5, 63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44,
+	    32, 23, 11, 46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7,
+	    6};
+	// De Bruijn multiplication
+	return table[((mask & (~mask + 1)) * 0x03f79d71b4cb0a89ull) >> 58];
+}
+
+/**
+ * Picks shown objects from found ones
+ *
+ * @param mask Bit mask of found objects
+ * @param list Objects for the line
+ */
+inline void selectObjects(std::uint64_t mask, SObjectList *list) {
+	list->Count = 0;
+	list->Overflow = -1;
+	for (; mask != 0; mask &= mask - 1) {
+		int index = getLowestBit(mask);
+		if (list->Count == LineObjects) {
+			list->Overflow = index;
+			break;
+		}
+		list->Index[list->Count++] = index;
+	}
+}
+
+/**
+ * Object prepared for drawing on one line
+ */
+struct SLineObject {
+	/**
+	 * Pattern row address
+	 */
+	std::uint16_t Pattern;
+	/**
+	 * Horizontal flip
+	 */
+	bool Flip;
+	/**
+	 * Pixel flags (palette, priority and object 0)
+	 */
+	std::uint8_t Flags;
+	/**
+	 * Horizontal position
+	 */
+	std::uint8_t X;
+};
+
+/**
+ * Draws object pixels where no other object is drawn yet
+ *
+ * @param pixels 2-bit pixels of the pattern row
+ * @param object Object
+ * @param line Object line
+ */
+inline void drawObject(
+    const std::uint8_t *pixels, const SLineObject &object, std::uint8_t *line) {
+	std::uint8_t *objectLine = line + object.X;
+	int width = ScreenWidth - object.X;
+	if (width > TileWidth) {
+		width = TileWidth;
+	}
+	for (int pixel = 0; pixel < width; pixel++) {
+		if (pixels[pixel] && !objectLine[pixel]) {
+			objectLine[pixel] = object.Flags | pixels[pixel];
+		}
+	}
+}
+
+/**
+ * Finds object 0 hit without producing pixels
+ *
+ * @param background Background pixels
+ * @param backgroundFirst First shown background pixel
+ * @param objects Object pixels
+ * @param objectFirst First shown object pixel
+ * @param first First pixel
+ * @param last Pixel after the last one
+ * @return Position of the first object 0 hit or -1 if none
+ */
+inline int findObjectHit(const std::uint8_t *background, int backgroundFirst,
+    const std::uint8_t *objects, int objectFirst, int first, int last) {
+	if (first < backgroundFirst) {
+		first = backgroundFirst;
+	}
+	if (first < objectFirst) {
+		first = objectFirst;
+	}
+	if (last > ScreenWidth - 1) {
+		last = ScreenWidth - 1;
+	}
+	for (int x = first; x < last; x++) {
+		if (background[x] && (objects[x] & ObjectPixelZero)) {
+			return x;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Combines background and object pixels
+ *
+ * @param background Background pixels
+ * @param backgroundFirst First shown background pixel
+ * @param objects Object pixels
+ * @param objectFirst First shown object pixel
+ * @param colors Output colors of palette entries
+ * @param frame Output pixels
+ * @param first First pixel
+ * @param last Pixel after the last one
+ * @return Position of the first object 0 hit or -1 if none
+ */
+inline int combinePixels(const std::uint8_t *background, int backgroundFirst,
+    const std::uint8_t *objects, int objectFirst, const std::uint16_t *colors,
+    std::uint16_t *frame, int first, int last) {
+	int hit = -1;
+	for (int x = first; x < last; x++) {
+		std::uint8_t pixel = (x >= backgroundFirst) ? background[x] : 0;
+		std::uint8_t object = (x >= objectFirst) ? objects[x] : 0;
+		if (object) {
+			if (pixel && (object & ObjectPixelZero) && x != ScreenWidth - 1 &&
+			    hit < 0) {
+				hit = x;
+			}
+			if (!pixel || !(object & ObjectPixelBehind)) {
+				pixel = object & 0x1f;
+			}
+		}
+		frame[x] = colors[pixel];
+	}
+	return hit;
+}
+
+/**
+ * Deferred rendering
+ */
+enum {
+	BandLines = 16  //!< Lines rendered by one job
+};
+
+/**
+ * Render state of one line for deferred rendering
+ */
+struct SLineState {
+	/**
+	 * VRAM address at the start of the line
+	 */
+	std::uint16_t Address;
+	/**
+	 * Background pattern page
+	 */
+	std::uint16_t BackgroundPage;
+	/**
+	 * Fine X scroll
+	 */
+	int FineX;
+	/**
+	 * First shown background pixel
+	 */
+	int BackgroundFirst;
+	/**
+	 * First shown object pixel
+	 */
+	int ObjectFirst;
+	/**
+	 * Amount of objects
+	 */
+	int ObjectCount;
+	/**
+	 * Objects in priority order
+	 */
+	SLineObject Objects[LineObjects];
+	/**
+	 * Output colors of palette entries
+	 */
+	std::uint16_t Colors[0x20];
+};
+
+}  // namespace ppu
+
+}  // namespace core
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_CORE_PPU_RENDER_HPP_
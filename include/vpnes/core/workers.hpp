@@ -0,0 +1,137 @@
+/**
+ * @file
+ *
+ * Defines worker thread pool
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifndef INCLUDE_VPNES_CORE_WORKERS_HPP_
+#define INCLUDE_VPNES_CORE_WORKERS_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+/**
+ * Pool of worker threads
+ */
+class CWorkerPool {
+public:
+	/**
+	 * Job
+	 */
+	typedef std::function<void()> job_t;
+
+private:
+	/**
+	 * Worker threads
+	 */
+	std::vector<std::thread> m_Threads;
+	/**
+	 * Queued jobs
+	 */
+	std::deque<job_t> m_Jobs;
+	/**
+	 * Number of jobs being executed
+	 */
+	std::size_t m_Running;
+	/**
+	 * Pool is being destroyed
+	 */
+	bool m_Stopping;
+	/**
+	 * Lock for jobs
+	 */
+	std::mutex m_Mutex;
+	/**
+	 * Signals new jobs
+	 */
+	std::condition_variable m_JobAdded;
+	/**
+	 * Signals finished jobs
+	 */
+	std::condition_variable m_JobDone;
+
+	/**
+	 * Worker thread routine
+	 */
+	void work();
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CWorkerPool() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param threads Number of threads
+	 */
+	explicit CWorkerPool(std::size_t threads);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CWorkerPool(const CWorkerPool &s) = delete;
+	/**
+	 * Waits for the running jobs and stops the threads
+	 */
+	~CWorkerPool();
+
+	/**
+	 * Queues a job
+	 *
+	 * @param job Job
+	 */
+	void addJob(job_t job);
+	/**
+	 * Waits until all queued jobs are done
+	 */
+	void wait();
+	/**
+	 * Gets number of threads
+	 *
+	 * @return Number of threads
+	 */
+	std::size_t getSize() const {
+		return m_Threads.size();
+	}
+};
+
+}  // namespace core
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_CORE_WORKERS_HPP_
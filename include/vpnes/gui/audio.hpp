@@ -0,0 +1,163 @@
+/**
+ * @file
+ *
+ * Defines audio output
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_AUDIO_HPP_
+#define INCLUDE_VPNES_GUI_AUDIO_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/buffers.hpp>
+#include <vpnes/gui/rate.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Plays emulated samples on an SDL audio device
+ *
+ * Samples are passed to the device callback through a lock-free ring. The
+ * emulation clock and the device clock drift apart, so either the sample
+ * rate requested from the emulator is nudged to keep the ring at a
+ * constant fill level, or the device is the clock source and emulation
+ * waits for it to drain the ring.
+ */
+class CAudioOutput {
+private:
+	/**
+	 * Buffering parameters
+	 */
+	enum {
+		DeviceSamples = 512,  //!< Samples per device callback
+		TargetFill = 1536,    //!< Ring fill after a frame kept by rate control
+		SyncFill = 640,       //!< Ring fill emulation waits for if clocked
+		RingSize = 4096,      //!< Ring capacity
+		WaitBuffers = 2       //!< Callbacks waited for past expected drain
+	};
+
+	/**
+	 * Audio device
+	 */
+	::SDL_AudioDeviceID m_Device;
+	/**
+	 * Device sample rate
+	 */
+	double m_Rate;
+	/**
+	 * Device clock paces emulation
+	 */
+	bool m_ClockSource;
+	/**
+	 * Samples passed to the device
+	 */
+	CSPSCRing<std::int16_t, RingSize> m_Ring;
+	/**
+	 * Rate control
+	 */
+	CRateControl m_RateControl;
+	/**
+	 * Playback has started
+	 */
+	bool m_Playing;
+	/**
+	 * Device stopped draining the ring
+	 */
+	bool m_Stalled;
+	/**
+	 * Samples read by the device when it stalled
+	 */
+	std::size_t m_StallPosition;
+	/**
+	 * Last played sample (repeated on underrun)
+	 */
+	std::int16_t m_LastSample;
+
+	/**
+	 * Device callback
+	 *
+	 * @param userData Audio output
+	 * @param stream Output buffer
+	 * @param len Buffer size in bytes
+	 */
+	static void SDLCALL callback(void *userData, ::Uint8 *stream, int len);
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CAudioOutput() = delete;
+	/**
+	 * Opens audio device
+	 *
+	 * @param rate Requested sample rate
+	 * @param clockSource Device clock paces emulation
+	 */
+	CAudioOutput(int rate, bool clockSource);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CAudioOutput(const CAudioOutput &s) = delete;
+	/**
+	 * Closes audio device
+	 */
+	~CAudioOutput();
+
+	/**
+	 * Queues samples and updates rate control
+	 *
+	 * @param samples Samples
+	 * @param count Number of samples
+	 */
+	void write(const std::int16_t *samples, std::size_t count);
+	/**
+	 * Blocks until the device drains the ring (if it is the clock source)
+	 *
+	 * @return False if the device did not pace emulation
+	 */
+	bool wait();
+	/**
+	 * Gets sample rate to synthesize at
+	 *
+	 * @return Sample rate in Hz
+	 */
+	double getSampleRate() const {
+		return m_Rate * m_RateControl.getRatio();
+	}
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_AUDIO_HPP_
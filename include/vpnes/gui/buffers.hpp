@@ -0,0 +1,319 @@
+/**
+ * @file
+ *
+ * Defines lock-free buffers for passing data between threads
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_BUFFERS_HPP_
+#define INCLUDE_VPNES_GUI_BUFFERS_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Triple buffer for a single writer and a single reader
+ *
+ * The writer fills the back buffer and publishes it, the reader takes the
+ * newest published buffer. Neither side ever waits for the other.
+ */
+template <typename T>
+class CTripleBuffer {
+private:
+	/**
+	 * Index bits of the shared buffer state
+	 */
+	enum {
+		IndexMask = 0x03,  //!< Index of the buffer in the middle
+		Fresh = 0x04       //!< Middle buffer is published but not taken
+	};
+
+	/**
+	 * Buffers
+	 */
+	std::unique_ptr<T[]> m_Buffers[3];
+	/**
+	 * Buffer being written
+	 */
+	unsigned m_Back;
+	/**
+	 * Buffer exchanged between the threads
+	 */
+	std::atomic<unsigned> m_Middle;
+	/**
+	 * Buffer being read
+	 */
+	unsigned m_Front;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CTripleBuffer() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param size Number of elements in each buffer
+	 */
+	explicit CTripleBuffer(std::size_t size)
+	    : m_Buffers{std::unique_ptr<T[]>(new T[size]()),
+	          std::unique_ptr<T[]>(new T[size]()),
+	          std::unique_ptr<T[]>(new T[size]())}
+	    , m_Back(0)
+	    , m_Middle(1)
+	    , m_Front(2) {
+	}
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CTripleBuffer(const CTripleBuffer &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CTripleBuffer() = default;
+
+	/**
+	 * Gets buffer for writing
+	 *
+	 * @return Back buffer
+	 */
+	T *getBack() const {
+		return m_Buffers[m_Back].get();
+	}
+	/**
+	 * Publishes back buffer and starts a new one
+	 */
+	void publish() {
+		m_Back = m_Middle.exchange(m_Back | Fresh, std::memory_order_acq_rel) &
+		         IndexMask;
+	}
+	/**
+	 * Takes the newest published buffer
+	 *
+	 * @return True if a new buffer was published since the last call
+	 */
+	bool update() {
+		if (!(m_Middle.load(std::memory_order_relaxed) & Fresh)) {
+			return false;
+		}
+		m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) &
+		          IndexMask;
+		return true;
+	}
+	/**
+	 * Gets buffer for reading
+	 *
+	 * @return Front buffer
+	 */
+	const T *getFront() const {
+		return m_Buffers[m_Front].get();
+	}
+};
+
+/**
+ * Bounded queue for a single producer and a single consumer
+ */
+template <typename T, std::size_t Size>
+class CSPSCQueue {
+private:
+	/**
+	 * Slots (one is always kept free)
+	 */
+	T m_Items[Size + 1];
+	/**
+	 * Next slot to read
+	 */
+	std::atomic<std::size_t> m_Head;
+	/**
+	 * Next slot to write
+	 */
+	std::atomic<std::size_t> m_Tail;
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CSPSCQueue() : m_Items(), m_Head(0), m_Tail(0) {
+	}
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CSPSCQueue(const CSPSCQueue &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CSPSCQueue() = default;
+
+	/**
+	 * Adds an item
+	 *
+	 * @param item Item
+	 * @return False if the queue is full
+	 */
+	bool push(const T &item) {
+		std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+		std::size_t next = (tail + 1) % (Size + 1);
+		if (next == m_Head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		m_Items[tail] = item;
+		m_Tail.store(next, std::memory_order_release);
+		return true;
+	}
+	/**
+	 * Removes the oldest item
+	 *
+	 * @param item Removed item
+	 * @return False if the queue is empty
+	 */
+	bool pop(T &item) {
+		std::size_t head = m_Head.load(std::memory_order_relaxed);
+		if (head == m_Tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = m_Items[head];
+		m_Head.store((head + 1) % (Size + 1), std::memory_order_release);
+		return true;
+	}
+};
+
+/**
+ * Ring of plain values for a single producer and a single consumer
+ *
+ * Values are copied in blocks, positions only grow and wrap on access.
+ */
+template <typename T, std::size_t Size>
+class CSPSCRing {
+private:
+	/**
+	 * Values
+	 */
+	T m_Items[Size];
+	/**
+	 * Number of values read so far
+	 */
+	std::atomic<std::size_t> m_Head;
+	/**
+	 * Number of values written so far
+	 */
+	std::atomic<std::size_t> m_Tail;
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CSPSCRing() : m_Items(), m_Head(0), m_Tail(0) {
+	}
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CSPSCRing(const CSPSCRing &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CSPSCRing() = default;
+
+	/**
+	 * Adds values
+	 *
+	 * @param items Values
+	 * @param count Number of values
+	 * @return Number of values added before the ring got full
+	 */
+	std::size_t write(const T *items, std::size_t count) {
+		std::size_t tail = m_Tail.load(std::memory_order_relaxed);
+		count = std::min(
+		    count, Size - (tail - m_Head.load(std::memory_order_acquire)));
+		std::size_t offset = tail % Size;
+		std::size_t first = std::min(count, Size - offset);
+		std::copy(items, items + first, m_Items + offset);
+		std::copy(items + first, items + count, m_Items);
+		m_Tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+	/**
+	 * Removes the oldest values
+	 *
+	 * @param items Removed values
+	 * @param count Maximum number of values
+	 * @return Number of values removed
+	 */
+	std::size_t read(T *items, std::size_t count) {
+		std::size_t head = m_Head.load(std::memory_order_relaxed);
+		count =
+		    std::min(count, m_Tail.load(std::memory_order_acquire) - head);
+		std::size_t offset = head % Size;
+		std::size_t first = std::min(count, Size - offset);
+		std::copy(m_Items + offset, m_Items + offset + first, items);
+		std::copy(m_Items, m_Items + count - first, items + first);
+		m_Head.store(head + count, std::memory_order_release);
+		return count;
+	}
+	/**
+	 * Gets number of stored values
+	 *
+	 * @return Number of values
+	 */
+	std::size_t getCount() const {
+		std::size_t head = m_Head.load(std::memory_order_acquire);
+		return m_Tail.load(std::memory_order_acquire) - head;
+	}
+	/**
+	 * Gets number of values read so far
+	 *
+	 * @return Number of values
+	 */
+	std::size_t getReadCount() const {
+		return m_Head.load(std::memory_order_acquire);
+	}
+	/**
+	 * Gets capacity
+	 *
+	 * @return Number of values
+	 */
+	static constexpr std::size_t getSize() {
+		return Size;
+	}
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_BUFFERS_HPP_
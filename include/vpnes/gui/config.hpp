@@ -30,7 +30,6 @@
 #include "config.h"
 #endif
 
-#include <fstream>
 #include <string>
 #include <vpnes/vpnes.hpp>
 
@@ -47,6 +46,38 @@ private:
 	 * File name
 	 */
 	std::string inputFile;
+	/**
+	 * Accuracy/performance profile
+	 */
+	std::string profile;
+	/**
+	 * Show every n-th frame
+	 */
+	int frameSkip;
+	/**
+	 * Filter frames through NTSC composite video emulation
+	 */
+	bool ntscFilter;
+	/**
+	 * Pixel-art scaler name
+	 */
+	std::string scaler;
+	/**
+	 * Lock frame rate to display vsync
+	 */
+	bool vsync;
+	/**
+	 * Report frame pacing statistics on exit
+	 */
+	bool pacingStats;
+	/**
+	 * Audio sample rate (0 disables audio)
+	 */
+	int sampleRate;
+	/**
+	 * Pace emulation by audio device instead of wall clock
+	 */
+	bool audioSync;
 
 protected:
 	/**
@@ -56,19 +87,14 @@ protected:
 	 * @param value Argument
 	 * @return Valid option or not
 	 */
-	virtual bool parseOption(
-	    const std::string &name, const std::string &value) {
-		return false;
-	}
+	virtual bool parseOption(const std::string &name, const std::string &value);
 	/**
 	 * Parse command line option
 	 *
 	 * @param name Option name
 	 * @return Valid option or not
 	 */
-	virtual bool parseOption(const std::string &name) {
-		return false;
-	}
+	virtual bool parseOption(const std::string &name);
 
 public:
 	/**
@@ -110,11 +136,77 @@ public:
 		inputFile = fileName;
 	}
 	/**
-	 * Opens input file and constructs ifstream object
+	 * Gets input file path
+	 *
+	 * @return Input file path
+	 */
+	const std::string &getInputFile() const noexcept {
+		return inputFile;
+	}
+	/**
+	 * Gets accuracy/performance profile
+	 *
+	 * @return Profile name
+	 */
+	const std::string &getProfile() const noexcept {
+		return profile;
+	}
+	/**
+	 * Gets frame skip ratio
 	 *
-	 * @return std::ifstream for reading file
+	 * @return Every n-th frame is shown
 	 */
-	std::ifstream getInputFile();
+	int getFrameSkip() const noexcept {
+		return frameSkip;
+	}
+	/**
+	 * Checks if NTSC filter is enabled
+	 *
+	 * @return True if enabled
+	 */
+	bool isNTSCFilterEnabled() const noexcept {
+		return ntscFilter;
+	}
+	/**
+	 * Gets pixel-art scaler
+	 *
+	 * @return Scaler name
+	 */
+	const std::string &getScaler() const noexcept {
+		return scaler;
+	}
+	/**
+	 * Checks if frame rate is locked to vsync
+	 *
+	 * @return True if locked
+	 */
+	bool isVSyncEnabled() const noexcept {
+		return vsync;
+	}
+	/**
+	 * Checks if frame pacing statistics are reported
+	 *
+	 * @return True if reported
+	 */
+	bool isPacingStatsEnabled() const noexcept {
+		return pacingStats;
+	}
+	/**
+	 * Gets audio sample rate
+	 *
+	 * @return Sample rate in Hz or 0 if audio is disabled
+	 */
+	int getSampleRate() const noexcept {
+		return sampleRate;
+	}
+	/**
+	 * Checks if emulation is paced by audio device
+	 *
+	 * @return True if paced by audio
+	 */
+	bool isAudioSyncEnabled() const noexcept {
+		return audioSync;
+	}
 };
 
 }  // namespace gui
@@ -31,11 +31,20 @@
 #endif
 
 #include <SDL.h>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <chrono>
+#include <thread>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/gui/config.hpp>
+#include <vpnes/gui/audio.hpp>
+#include <vpnes/gui/buffers.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/gui/ntsc.hpp>
+#include <vpnes/gui/pacer.hpp>
+#include <vpnes/gui/scaler.hpp>
 #include <vpnes/core/frontend.hpp>
 #include <vpnes/core/nes.hpp>
 
@@ -49,13 +58,9 @@ namespace gui {
 class CGUI : public core::CFrontEnd {
 protected:
 	/**
-	 * Jitter
+	 * Frame pacing
 	 */
-	double m_Jitter;
-	/**
-	 * Time overhead
-	 */
-	double m_TimeOverhead;
+	CFramePacer m_Pacer;
 	/**
 	 * Frame start point
 	 */
@@ -80,6 +85,76 @@ protected:
 	 * Main screen buffer
 	 */
 	::SDL_Texture *m_ScreenBuffer;
+	/**
+	 * Frame converter for screen buffer format
+	 */
+	std::unique_ptr<CFrameConverter> m_FrameConverter;
+	/**
+	 * NTSC filter used instead of frame converter if enabled
+	 */
+	std::unique_ptr<CNTSCFilter> m_NTSCFilter;
+	/**
+	 * Pixel-art scaler
+	 */
+	std::unique_ptr<CScaler> m_Scaler;
+	/**
+	 * Audio output
+	 */
+	std::unique_ptr<CAudioOutput> m_Audio;
+	/**
+	 * Frames passed from emulation thread to presentation
+	 */
+	CTripleBuffer<std::uint16_t> m_Frames;
+	/**
+	 * Input events passed from presentation to emulation thread
+	 */
+	CSPSCQueue<::SDL_Event, 64> m_Events;
+	/**
+	 * Scaled frame
+	 */
+	std::unique_ptr<std::uint16_t[]> m_ScaledBuffer;
+	/**
+	 * Converted frame for scalers working on host pixels
+	 */
+	std::unique_ptr<std::uint32_t[]> m_ConvertedBuffer;
+	/**
+	 * Host pixels of the processed frame
+	 */
+	std::unique_ptr<std::uint8_t[]> m_Pixels;
+	/**
+	 * Line size of host pixels in bytes
+	 */
+	std::size_t m_PixelsPitch;
+	/**
+	 * Emulation has finished
+	 */
+	std::atomic<bool> m_Stopped;
+	/**
+	 * Window was closed
+	 */
+	std::atomic<bool> m_QuitRequested;
+#ifdef VPNES_MEASURE_FPS
+	/**
+	 * Measured emulation speed
+	 */
+	std::atomic<double> m_FPS;
+#endif
+	/**
+	 * Emulation thread
+	 */
+	std::thread m_EmulationThread;
+	/**
+	 * Frames left to skip before the next shown one
+	 */
+	int m_SkippedFrames;
+	/**
+	 * Current frame is shown
+	 */
+	bool m_FrameShown;
+	/**
+	 * Audio device paced the last block
+	 */
+	bool m_AudioPaced;
 
 	/**
 	 * (Re-)init main window
@@ -88,6 +163,20 @@ protected:
 	 * @param height Height
 	 */
 	void initMainWindow(std::size_t width, std::size_t height);
+	/**
+	 * Converts frame to host pixels
+	 *
+	 * @param frameBuffer Frame
+	 */
+	void processFrame(const std::uint16_t *frameBuffer);
+	/**
+	 * Emulation thread routine
+	 */
+	void emulate();
+	/**
+	 * Presents frames and collects input until emulation finishes
+	 */
+	void present();
 
 public:
 	/**
@@ -112,12 +201,31 @@ public:
 	 * @return Exit code
 	 */
 	int startGUI(int argc, char **argv);
+	/**
+	 * Gets buffer for the next frame
+	 *
+	 * @return Frame buffer or nullptr if the frame is skipped
+	 */
+	std::uint16_t *getFrameBuffer();
 	/**
 	 * Frame-ready callback
 	 *
 	 * @param frameTime Frame time
 	 */
 	void handleFrameRender(double frameTime);
+	/**
+	 * Gets audio sample rate
+	 *
+	 * @return Sample rate or 0 if audio is disabled
+	 */
+	double getSampleRate();
+	/**
+	 * Audio block callback
+	 *
+	 * @param samples Samples
+	 * @param count Number of samples
+	 */
+	void handleAudio(const std::int16_t *samples, std::size_t count);
 };
 
 }  // namespace gui
@@ -0,0 +1,169 @@
+/**
+ * @file
+ *
+ * Defines NTSC composite video filter
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_NTSC_HPP_
+#define INCLUDE_VPNES_GUI_NTSC_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/core/frontend.hpp>
+#include <vpnes/core/workers.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Emulates composite video signal of NES and its decoding by a TV
+ *
+ * Each NES pixel is 8 samples of the signal, 12 samples make a color
+ * subcarrier cycle. The decoder averages 12 samples around each output
+ * pixel, so an output pixel depends on up to 3 NES pixels. The filter is
+ * linear, so contributions of every color at every subcarrier phase are
+ * precomputed and output pixels are sums of table entries.
+ */
+class CNTSCFilter {
+public:
+	/**
+	 * Output geometry
+	 */
+	enum {
+		Width = core::frame::Width * 2,  //!< Output pixels per line
+		Height = core::frame::Height     //!< Output lines
+	};
+
+private:
+	/**
+	 * Table geometry
+	 */
+	enum {
+		Phases = 3,     //!< Subcarrier phases of NES pixels
+		PartFull = 0,   //!< Whole pixel (shared by both output pixels)
+		PartTail = 1,   //!< Last half of the pixel for the next pixel
+		PartHead = 2,   //!< First half of the pixel for the previous pixel
+		Parts = 3,      //!< Parts of the pixel
+		Channels = 4,   //!< Channels in output byte order
+		FixedShift = 5  //!< Fractional bits of table entries
+	};
+
+	/**
+	 * Pixel format
+	 */
+	CFrameConverter::EPixelFormat m_Format;
+	/**
+	 * Contributions of colors to output pixels
+	 */
+	std::int16_t m_Table[Phases][core::frame::Colors][Parts][Channels];
+	/**
+	 * Subcarrier phase of the current frame
+	 */
+	std::size_t m_FramePhase;
+	/**
+	 * Workers filtering bands of lines
+	 */
+	core::CWorkerPool m_Workers;
+
+	/**
+	 * Generates signal sample
+	 *
+	 * @param pixel NES color with emphasis
+	 * @param phase Subcarrier phase of the sample (0-11)
+	 * @return Signal level (0 is black, 1 is white)
+	 */
+	static double getSignal(std::size_t pixel, std::size_t phase);
+	/**
+	 * Filters a line
+	 *
+	 * @param src Source line
+	 * @param dst Output line
+	 * @param phase Subcarrier phase of the first pixel
+	 */
+	void filterLine(
+	    const std::uint16_t *src, std::uint32_t *dst, std::size_t phase) const;
+	/**
+	 * Filters a band of lines
+	 *
+	 * @param frameBuffer Frame
+	 * @param pixels Output pixels
+	 * @param pitch Output line size in bytes
+	 * @param first First line
+	 * @param last Line after the last one
+	 */
+	void filterLines(const std::uint16_t *frameBuffer, void *pixels,
+	    std::size_t pitch, std::size_t first, std::size_t last) const;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CNTSCFilter() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param format Pixel format (32-bit only)
+	 */
+	explicit CNTSCFilter(CFrameConverter::EPixelFormat format);
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CNTSCFilter(const CNTSCFilter &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CNTSCFilter() = default;
+
+	/**
+	 * Gets pixel format
+	 *
+	 * @return Pixel format
+	 */
+	CFrameConverter::EPixelFormat getFormat() const {
+		return m_Format;
+	}
+	/**
+	 * Filters frame
+	 *
+	 * @param frameBuffer Frame (core::frame::Width * core::frame::Height)
+	 * @param pixels Output pixels (Width * Height)
+	 * @param pitch Output line size in bytes
+	 */
+	void filter(const std::uint16_t *frameBuffer, void *pixels,
+	    std::size_t pitch);
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_NTSC_HPP_
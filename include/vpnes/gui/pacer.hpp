@@ -0,0 +1,155 @@
+/**
+ * @file
+ *
+ * Defines frame pacing
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_PACER_HPP_
+#define INCLUDE_VPNES_GUI_PACER_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Paces emulated frames in real time
+ *
+ * Frames are scheduled on absolute deadlines, so waiting errors do not
+ * accumulate. Most of the wait is slept, the rest is spent spinning on the
+ * clock. wait() is called by the emulation thread, handleVSync() by the
+ * thread presenting frames.
+ */
+class CFramePacer {
+public:
+	/**
+	 * Frame time statistics
+	 */
+	struct SStatistics {
+		std::size_t Frames;  //!< Number of measured frames
+		double Mean;         //!< Mean frame time error in ms
+		double Deviation;    //!< Standard deviation of frame time in ms
+		double Max;          //!< Largest absolute error in ms
+	};
+
+private:
+	/**
+	 * Pacing constants
+	 */
+	enum {
+		SpinTime = 2000000,     //!< Time spun before deadline in ns
+		MaxLag = 100000000,     //!< Largest lag caught up in ns
+		LockTolerance = 100,    //!< Refresh is locked within 1/100 of frame
+		RefreshSmoothing = 16   //!< Weight of refresh estimate in averaging
+	};
+
+	/**
+	 * Deadline for the current frame
+	 */
+	std::chrono::steady_clock::time_point m_Deadline;
+	/**
+	 * End of the previous frame
+	 */
+	std::chrono::steady_clock::time_point m_LastFrame;
+	/**
+	 * Pacing has started
+	 */
+	bool m_Started;
+	/**
+	 * Display refresh period in ms or 0 if not locked
+	 */
+	std::atomic<double> m_RefreshPeriod;
+	/**
+	 * Previous synchronized present
+	 */
+	std::chrono::steady_clock::time_point m_LastVSync;
+	/**
+	 * Number of measured frames
+	 */
+	std::size_t m_Frames;
+	/**
+	 * Sum of frame time errors
+	 */
+	double m_ErrorSum;
+	/**
+	 * Sum of squared frame time errors
+	 */
+	double m_ErrorSquareSum;
+	/**
+	 * Largest absolute frame time error
+	 */
+	double m_MaxError;
+
+public:
+	/**
+	 * Constructs the object
+	 */
+	CFramePacer();
+	/**
+	 * Deleted copy constructor
+	 *
+	 * @param s Copied value
+	 */
+	CFramePacer(const CFramePacer &s) = delete;
+	/**
+	 * Destroys the object
+	 */
+	~CFramePacer() = default;
+
+	/**
+	 * Locks frame rate to display refresh rate
+	 *
+	 * @param period Refresh period in ms
+	 */
+	void lockToRefresh(double period);
+	/**
+	 * Refines refresh period after a present synchronized to vsync
+	 */
+	void handleVSync();
+	/**
+	 * Waits until the frame is due
+	 *
+	 * @param frameTime Emulated frame time in ms
+	 */
+	void wait(double frameTime);
+	/**
+	 * Gets frame time statistics
+	 *
+	 * @return Statistics
+	 */
+	SStatistics getStatistics() const;
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_PACER_HPP_
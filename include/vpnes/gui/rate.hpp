@@ -0,0 +1,124 @@
+/**
+ * @file
+ *
+ * Defines rate control keeping an audio buffer at a constant fill level
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_RATE_HPP_
+#define INCLUDE_VPNES_GUI_RATE_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <vpnes/vpnes.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Adjusts sample rate to keep buffer fill at a target level
+ *
+ * The fill level is averaged over a few blocks, and its error drives a
+ * proportional-integral controller. The integral term estimates the drift
+ * between the producer and consumer clocks, so the fill settles at the
+ * target. The rate never changes by more than 1 / MaxAdjust.
+ */
+class CRateControl {
+public:
+	/**
+	 * Control parameters
+	 */
+	enum {
+		FillSmoothing = 8,  //!< Blocks to average the fill level over
+		DriftTime = 120,    //!< Blocks to integrate clock drift over
+		MaxAdjust = 200     //!< Largest rate change is 1 / MaxAdjust
+	};
+
+private:
+	/**
+	 * Target fill level
+	 */
+	double m_Target;
+	/**
+	 * Average fill level
+	 */
+	double m_Fill;
+	/**
+	 * Integrated fill error (estimated clock drift)
+	 */
+	double m_Drift;
+	/**
+	 * Current rate ratio
+	 */
+	double m_Ratio;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CRateControl() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param target Target fill level
+	 */
+	explicit CRateControl(std::size_t target)
+	    : m_Target(target), m_Fill(target), m_Drift(0), m_Ratio(1.0) {
+	}
+	/**
+	 * Destroys the object
+	 */
+	~CRateControl() = default;
+
+	/**
+	 * Updates rate after a block
+	 *
+	 * @param fill Fill level after the block
+	 */
+	void update(std::size_t fill) {
+		m_Fill += (fill - m_Fill) / FillSmoothing;
+		double error = (m_Target - m_Fill) / m_Target;
+		// Drift is integrated so the fill settles at the target
+		m_Drift = std::max(-1.0, std::min(m_Drift + error / DriftTime, 1.0));
+		double adjust = std::max(-1.0, std::min(error + m_Drift, 1.0));
+		m_Ratio = 1.0 + adjust / MaxAdjust;
+	}
+	/**
+	 * Gets rate ratio
+	 *
+	 * @return Ratio of producer rate to nominal rate
+	 */
+	double getRatio() const {
+		return m_Ratio;
+	}
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_RATE_HPP_
@@ -0,0 +1,204 @@
+/**
+ * @file
+ *
+ * Defines pixel-art scalers
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifndef INCLUDE_VPNES_GUI_SCALER_HPP_
+#define INCLUDE_VPNES_GUI_SCALER_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/frontend.hpp>
+#include <vpnes/gui/video.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Scales NES frames
+ *
+ * Scale2x and Scale3x work on NES colors before conversion, so edges are
+ * detected by exact comparison and the result is converted like an
+ * ordinary frame. HQ2x and xBR blend colors, so they run on 32-bit host
+ * pixels after conversion. HQ2x here is a reduction to the corner rules of
+ * the original filter without its lookup table, so shallow edges differ.
+ */
+class CScaler {
+public:
+	/**
+	 * Available scalers
+	 */
+	enum EScaler {
+		ScalerNearest,  //!< No scaling (stretched by the renderer)
+		ScalerScale2x,  //!< Scale2x (AdvMAME2x)
+		ScalerScale3x,  //!< Scale3x (AdvMAME3x)
+		ScalerHQ2x,     //!< HQ2x corner rules (reduced HQ2x)
+		ScalerXBR       //!< 2xBR
+	};
+
+private:
+	/**
+	 * Scaler
+	 */
+	EScaler m_Scaler;
+
+	/**
+	 * Scales a line by 2
+	 *
+	 * @param above Line above with border pixels
+	 * @param line Line with border pixels
+	 * @param below Line below with border pixels
+	 * @param dst Output lines
+	 */
+	static void scale2x(const std::uint16_t *above, const std::uint16_t *line,
+	    const std::uint16_t *below, std::uint16_t *dst);
+	/**
+	 * Scales a line by 3
+	 *
+	 * @param above Line above with border pixels
+	 * @param line Line with border pixels
+	 * @param below Line below with border pixels
+	 * @param dst Output lines
+	 */
+	static void scale3x(const std::uint16_t *above, const std::uint16_t *line,
+	    const std::uint16_t *below, std::uint16_t *dst);
+	/**
+	 * Scales a line by 2 with reduced HQ2x corner rules
+	 *
+	 * @param lines Lines from 2 above to 2 below with border pixels
+	 * @param yuv YUV values of the lines
+	 * @param dst0 Upper output line
+	 * @param dst1 Lower output line
+	 */
+	static void hq2x(const std::uint32_t *const *lines,
+	    const std::uint32_t *const *yuv, std::uint32_t *dst0,
+	    std::uint32_t *dst1);
+	/**
+	 * Scales a line by 2 with 2xBR
+	 *
+	 * @param lines Lines from 2 above to 2 below with border pixels
+	 * @param yuv YUV values of the lines
+	 * @param dst0 Upper output line
+	 * @param dst1 Lower output line
+	 */
+	static void xbr(const std::uint32_t *const *lines,
+	    const std::uint32_t *const *yuv, std::uint32_t *dst0,
+	    std::uint32_t *dst1);
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CScaler() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param scaler Scaler
+	 */
+	explicit CScaler(EScaler scaler) : m_Scaler(scaler) {
+	}
+	/**
+	 * Constructs the object
+	 *
+	 * @param name Scaler name
+	 */
+	explicit CScaler(const std::string &name);
+	/**
+	 * Destroys the object
+	 */
+	~CScaler() = default;
+
+	/**
+	 * Gets scale factor
+	 *
+	 * @return Scale factor
+	 */
+	std::size_t getFactor() const {
+		switch (m_Scaler) {
+		case ScalerScale2x:
+		case ScalerHQ2x:
+		case ScalerXBR:
+			return 2;
+		case ScalerScale3x:
+			return 3;
+		default:
+			return 1;
+		}
+	}
+	/**
+	 * Checks if the scaler works on host pixels
+	 *
+	 * @return True if frames are converted before scaling
+	 */
+	bool isHostScaler() const {
+		return m_Scaler == ScalerHQ2x || m_Scaler == ScalerXBR;
+	}
+	/**
+	 * Gets width of scaled frame
+	 *
+	 * @return Width
+	 */
+	std::size_t getWidth() const {
+		return core::frame::Width * getFactor();
+	}
+	/**
+	 * Gets height of scaled frame
+	 *
+	 * @return Height
+	 */
+	std::size_t getHeight() const {
+		return core::frame::Height * getFactor();
+	}
+	/**
+	 * Scales frame
+	 *
+	 * @param frameBuffer Frame (core::frame::Width * core::frame::Height)
+	 * @param scaled Output frame (getWidth() * getHeight())
+	 */
+	void scale(const std::uint16_t *frameBuffer, std::uint16_t *scaled) const;
+	/**
+	 * Scales converted frame
+	 *
+	 * @param frameBuffer 32-bit frame (core::frame::Width *
+	 * core::frame::Height)
+	 * @param pixels Output pixels (getWidth() * getHeight())
+	 * @param pitch Output line size in bytes
+	 * @param format Pixel format of the frame
+	 */
+	void scale(const std::uint32_t *frameBuffer, void *pixels,
+	    std::size_t pitch, CFrameConverter::EPixelFormat format) const;
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_SCALER_HPP_
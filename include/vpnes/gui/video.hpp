@@ -0,0 +1,146 @@
+/**
+ * @file
+ *
+ * Defines frame conversion to host pixel formats
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifndef INCLUDE_VPNES_GUI_VIDEO_HPP_
+#define INCLUDE_VPNES_GUI_VIDEO_HPP_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/frontend.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Converts NES frames to host pixels
+ */
+class CFrameConverter {
+public:
+	/**
+	 * Host pixel formats
+	 */
+	enum EPixelFormat {
+		PixelFormatRGBA32,  //!< Bytes R, G, B, A
+		PixelFormatBGRA32,  //!< Bytes B, G, R, A
+		PixelFormatRGB565   //!< Native 16-bit 5-6-5
+	};
+
+private:
+	/**
+	 * Pixel format
+	 */
+	EPixelFormat m_Format;
+	/**
+	 * Host pixels for every NES color and emphasis
+	 */
+	std::uint32_t m_Colors[core::frame::Colors];
+
+	/**
+	 * Converts a line to 32-bit pixels
+	 *
+	 * @param src Source line
+	 * @param dst Output line
+	 * @param width Line width (multiple of 16)
+	 */
+	void convertLine32(const std::uint16_t *src, std::uint32_t *dst,
+	    std::size_t width) const;
+	/**
+	 * Converts a line to 16-bit pixels
+	 *
+	 * @param src Source line
+	 * @param dst Output line
+	 * @param width Line width (multiple of 16)
+	 */
+	void convertLine16(const std::uint16_t *src, std::uint16_t *dst,
+	    std::size_t width) const;
+
+public:
+	/**
+	 * Deleted default constructor
+	 */
+	CFrameConverter() = delete;
+	/**
+	 * Constructs the object
+	 *
+	 * @param format Pixel format
+	 */
+	explicit CFrameConverter(EPixelFormat format);
+	/**
+	 * Destroys the object
+	 */
+	~CFrameConverter() = default;
+
+	/**
+	 * Gets pixel format
+	 *
+	 * @return Pixel format
+	 */
+	EPixelFormat getFormat() const {
+		return m_Format;
+	}
+	/**
+	 * Gets size of host pixel
+	 *
+	 * @return Size in bytes
+	 */
+	std::size_t getPixelSize() const {
+		return (m_Format == PixelFormatRGB565) ? 2 : 4;
+	}
+	/**
+	 * Converts frame of any size
+	 *
+	 * @param frameBuffer Frame
+	 * @param width Frame width (multiple of 16)
+	 * @param height Frame height
+	 * @param pixels Output pixels
+	 * @param pitch Output line size in bytes
+	 */
+	void convert(const std::uint16_t *frameBuffer, std::size_t width,
+	    std::size_t height, void *pixels, std::size_t pitch) const;
+	/**
+	 * Converts frame
+	 *
+	 * @param frameBuffer Frame (core::frame::Width * core::frame::Height)
+	 * @param pixels Output pixels
+	 * @param pitch Output line size in bytes
+	 */
+	void convert(const std::uint16_t *frameBuffer, void *pixels,
+	    std::size_t pitch) const {
+		convert(frameBuffer, core::frame::Width, core::frame::Height, pixels,
+		    pitch);
+	}
+};
+
+}  // namespace gui
+
+}  // namespace vpnes
+
+#endif  // INCLUDE_VPNES_GUI_VIDEO_HPP_
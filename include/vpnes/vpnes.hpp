@@ -45,6 +45,15 @@
 #define PACKAGE_BUILD PACKAGE_STRING " Build " __DATE__ " " __TIME__
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VPNES_SSE2 1
+#endif
+
+#ifdef __AVX2__
+#define VPNES_AVX2 1
+#endif
+
 namespace vpnes {
 
 /**
@@ -0,0 +1,126 @@
+/**
+ * @file
+ *
+ * Implements band-limited step buffer
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/blip.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+/* CBlipBuffer */
+
+/**
+ * Constructs the object
+ *
+ * @param frequency Clock period in ms
+ * @param blockTime Longest block in ticks
+ */
+CBlipBuffer::CBlipBuffer(double frequency, ticks_t blockTime)
+    : m_Frequency(frequency)
+    , m_BlockTime(blockTime)
+    , m_Factor(0)
+    , m_Offset(0)
+    , m_Kernel()
+    , m_Buffer()
+    , m_Samples()
+    , m_Integrator(0) {
+	const double pi = std::acos(-1.0);
+	// Cut off a bit below Nyquist frequency to leave room for the window
+	const double cutoff = 0.9;
+	for (std::size_t phase = 0; phase < Phases; phase++) {
+		double weights[Taps];
+		double sum = 0;
+		for (std::size_t tap = 0; tap < Taps; tap++) {
+			double x = static_cast<double>(tap) - Taps / 2 + 1 -
+			           static_cast<double>(phase) / Phases;
+			double sinc = (x == 0) ? cutoff
+			                       : std::sin(pi * cutoff * x) / (pi * x);
+			double window = 0.42 + 0.5 * std::cos(2 * pi * x / Taps) +
+			                0.08 * std::cos(4 * pi * x / Taps);
+			weights[tap] = sinc * window;
+			sum += weights[tap];
+		}
+		// Each kernel must add exactly one unit step
+		std::int32_t total = 0;
+		for (std::size_t tap = 0; tap < Taps; tap++) {
+			m_Kernel[phase][tap] = static_cast<std::int16_t>(
+			    std::lround(weights[tap] / sum * (1 << UnityBits)));
+			total += m_Kernel[phase][tap];
+		}
+		m_Kernel[phase][Taps / 2 - 1] += (1 << UnityBits) - total;
+	}
+}
+
+/**
+ * Sets output sample rate
+ *
+ * @param rate Sample rate in Hz
+ */
+void CBlipBuffer::setSampleRate(double rate) {
+	m_Factor = static_cast<std::uint64_t>(
+	    rate * m_Frequency / 1000.0 * std::ldexp(1.0, FractionBits));
+	std::size_t size = static_cast<std::size_t>(
+	    ((m_Offset + m_BlockTime * m_Factor) >> FractionBits) + 1);
+	// Steps slightly past the block end land in the spare room
+	m_Buffer.resize(size + Taps * 2, 0);
+	m_Samples.resize(size);
+}
+
+/**
+ * Ends block and produces samples
+ *
+ * @param time Block length in ticks
+ * @return Number of samples
+ */
+std::size_t CBlipBuffer::endBlock(ticks_t time) {
+	std::uint64_t end = m_Offset + static_cast<std::uint64_t>(time) * m_Factor;
+	std::size_t count = static_cast<std::size_t>(end >> FractionBits);
+	for (std::size_t i = 0; i < count; i++) {
+		m_Integrator += m_Buffer[i];
+		std::int32_t sample = m_Integrator >> UnityBits;
+		sample = std::max<std::int32_t>(sample, -32768);
+		m_Samples[i] = static_cast<std::int16_t>(std::min(sample, 32767));
+		m_Integrator -= m_Integrator >> HighPassShift;
+	}
+	// Tails of the last steps belong to the next block
+	std::copy(m_Buffer.begin() + count, m_Buffer.end(), m_Buffer.begin());
+	std::fill(m_Buffer.end() - count, m_Buffer.end(), 0);
+	m_Offset = end & ((static_cast<std::uint64_t>(1) << FractionBits) - 1);
+	return count;
+}
+
+}  // namespace core
+
+}  // namespace vpnes
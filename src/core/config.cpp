@@ -30,10 +30,11 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <utility>
-#include <fstream>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/config.hpp>
+#include <vpnes/core/image.hpp>
 #include <vpnes/core/ines.hpp>
 #include <vpnes/core/factory.hpp>
 
@@ -55,7 +56,8 @@ const NESFactory factoryList[MMCAmount] = {
  * Default constructor
  */
 SNESConfig::SNESConfig()
-    : CHR()
+    : Image()
+    , CHR()
     , PRG()
     , Trainer()
     , PRGSize()
@@ -63,27 +65,28 @@ SNESConfig::SNESConfig()
     , RAMSize()
     , MMCType()
     , Mirroring()
-    , NESType() {
+    , NESType()
+    , Profile() {
 }
 
 /**
  * Configures the class
  *
  * @param appConfig Application configuration
- * @param inputFile Input file stream
  */
-void SNESConfig::configure(
-    const gui::SApplicationConfig &appConfig, std::ifstream *inputFile) {
-	ines::SNESData nesData(inputFile);
+void SNESConfig::configure(const gui::SApplicationConfig &appConfig) {
+	Image = CROMRegistry::getRegistry().getImage(appConfig.getInputFile());
+	ines::SNESData nesData(*Image);
 	PRGSize = nesData.PRGSize;
 	CHRSize = nesData.CHRSize;
 	RAMSize = nesData.RAMSize;
 	Mirroring = nesData.Mirroring;
 	MMCType = nesData.MMCType;
 	NESType = nesData.NESType;
-	PRG = std::move(nesData.PRG);
-	CHR = std::move(nesData.CHR);
+	PRG = nesData.PRG;
+	CHR = nesData.CHR;
 	Trainer = std::move(nesData.Trainer);
+	Profile = appConfig.getProfile();
 }
 
 /**
@@ -2786,7 +2786,8 @@ struct CCPU::opcodes {
 	/**
 	 * Control
 	 */
-	using control = cpu::Control<opcodes>;
+	template <class StepMode>
+	using control = cpu::Control<opcodes, StepMode>;
 
 	/**
 	 * Sets a point since where to start next operation
@@ -2805,8 +2806,9 @@ struct CCPU::opcodes {
 	 * @param ackIRQ Acknowledge IRQ
 	 * @return If could or not
 	 */
+	template <class StepMode>
 	static bool accessBus(CCPU *cpu, CCPU::EBusMode busMode, bool ackIRQ) {
-		if (!cpu->isReady()) {
+		if (StepMode::CheckEachCycle && !cpu->isReady()) {
 			return false;
 		}
 		if (ackIRQ) {
@@ -2832,12 +2834,15 @@ struct CCPU::opcodes {
  * Constructs the object
  *
  * @param motherBoard Motherboard
+ * @param executor Execution routine
  */
-CCPU::CCPU(CMotherBoard *motherBoard)
+CCPU::CCPU(CMotherBoard *motherBoard, executor_t executor)
     : CClockedDevice()
     , m_MotherBoard(motherBoard)
+    , m_Executor(executor)
     , m_InternalClock()
-    , m_CurrentIndex(opcodes::control::ResetIndex)
+    , m_ClockOffset()
+    , m_CurrentIndex(opcodes::control<cpu::CycleStep>::ResetIndex)
     , m_RAM{}
     , m_PendingIRQ()
     , m_PendingNMI()
@@ -2862,13 +2867,26 @@ CCPU::CCPU(CMotherBoard *motherBoard)
     , m_Carry() {
 }
 
+/**
+ * Executes microcode till reaching current clock value
+ *
+ * @param cpu CPU
+ */
+template <class StepMode>
+void CCPU::executeStep(CCPU *cpu) {
+	while (cpu->isReady()) {
+		opcodes::control<StepMode>::execute(cpu, cpu->m_CurrentIndex);
+	}
+}
+
+template void CCPU::executeStep<cpu::CycleStep>(CCPU *cpu);
+template void CCPU::executeStep<cpu::InstructionStep>(CCPU *cpu);
+
 /**
  * Simulation routine
  */
 void CCPU::execute() {
-	while (isReady()) {
-		opcodes::control::execute(this, m_CurrentIndex);
-	}
+	(*m_Executor)(this);
 }
 
 }  // namespace core
@@ -0,0 +1,361 @@
+/**
+ * @file
+ *
+ * Implements memory-mapped ROM images and their registry
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/image.hpp>
+#include <vpnes/core/ppu_render.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+#ifdef _WIN32
+
+/**
+ * Reads identity of an open file
+ *
+ * @param file File handle
+ * @param fileID Output identity
+ * @return True on success
+ */
+inline bool readFileID(HANDLE file, SFileID &fileID) {
+	BY_HANDLE_FILE_INFORMATION info;
+	if (!::GetFileInformationByHandle(file, &info)) {
+		return false;
+	}
+	fileID.Device = info.dwVolumeSerialNumber;
+	fileID.Index = (std::uint64_t(info.nFileIndexHigh) << 32) |
+	               info.nFileIndexLow;
+	fileID.Size =
+	    (std::uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+	fileID.Time = std::int64_t(
+	    (std::uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) |
+	    info.ftLastWriteTime.dwLowDateTime);
+	return true;
+}
+
+/**
+ * Reads identity of a file
+ *
+ * @param fileName File path
+ * @param fileID Output identity
+ * @return True on success
+ */
+inline bool readFileID(const std::string &fileName, SFileID &fileID) {
+	HANDLE file = ::CreateFileA(fileName.c_str(), 0,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+	    FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	bool result = readFileID(file, fileID);
+	::CloseHandle(file);
+	return result;
+}
+
+#else
+
+/**
+ * Gets identity from file status
+ *
+ * @param status File status
+ * @return File identity
+ */
+inline SFileID readFileID(const struct stat &status) {
+	return {std::uint64_t(status.st_dev), std::uint64_t(status.st_ino),
+	    std::uint64_t(status.st_size), std::int64_t(status.st_mtime)};
+}
+
+/**
+ * Reads identity of a file
+ *
+ * @param fileName File path
+ * @param fileID Output identity
+ * @return True on success
+ */
+inline bool readFileID(const std::string &fileName, SFileID &fileID) {
+	struct stat status;
+	if (::stat(fileName.c_str(), &status) < 0) {
+		return false;
+	}
+	fileID = readFileID(status);
+	return true;
+}
+
+#endif
+
+/* CROMImage */
+
+#ifdef _WIN32
+
+/**
+ * Maps the file
+ *
+ * @param fileName File path
+ */
+CROMImage::CROMImage(const std::string &fileName)
+    : m_Data(), m_Size(), m_FileID(), m_TilesFlag(), m_Tiles() {
+	HANDLE file = ::CreateFileA(fileName.c_str(), GENERIC_READ,
+	    FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+	    nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::invalid_argument("Cannot open " + fileName);
+	}
+	if (!readFileID(file, m_FileID)) {
+		::CloseHandle(file);
+		throw std::invalid_argument("Cannot open " + fileName);
+	}
+	m_Size = static_cast<std::size_t>(m_FileID.Size);
+	if (m_Size == 0) {
+		::CloseHandle(file);
+		return;
+	}
+	// The view keeps the mapping alive, so the handles are not needed
+	HANDLE mapping =
+	    ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	::CloseHandle(file);
+	if (!mapping) {
+		throw std::invalid_argument("Cannot map " + fileName);
+	}
+	m_Data = static_cast<const std::uint8_t *>(
+	    ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	::CloseHandle(mapping);
+	if (!m_Data) {
+		throw std::invalid_argument("Cannot map " + fileName);
+	}
+}
+
+/**
+ * Unmaps the file
+ */
+CROMImage::~CROMImage() {
+	if (m_Data) {
+		::UnmapViewOfFile(m_Data);
+	}
+}
+
+#else
+
+/**
+ * Maps the file
+ *
+ * @param fileName File path
+ */
+CROMImage::CROMImage(const std::string &fileName)
+    : m_Data(), m_Size(), m_FileID(), m_TilesFlag(), m_Tiles() {
+	int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::invalid_argument("Cannot open " + fileName);
+	}
+	struct stat status;
+	if (::fstat(file, &status) < 0) {
+		::close(file);
+		throw std::invalid_argument("Cannot open " + fileName);
+	}
+	m_FileID = readFileID(status);
+	m_Size = static_cast<std::size_t>(status.st_size);
+	if (m_Size == 0) {
+		::close(file);
+		return;
+	}
+	// The mapping holds its own reference to the file
+	void *data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED) {
+		throw std::invalid_argument("Cannot map " + fileName);
+	}
+	m_Data = static_cast<const std::uint8_t *>(data);
+}
+
+/**
+ * Unmaps the file
+ */
+CROMImage::~CROMImage() {
+	if (m_Data) {
+		::munmap(const_cast<std::uint8_t *>(m_Data), m_Size);
+	}
+}
+
+#endif
+
+/**
+ * Gets pattern tables decoded from CHR ROM
+ *
+ * The tiles are decoded on the first call and shared by all users of the
+ * image. Every call must pass the same CHR ROM.
+ *
+ * @param offset Offset of 8 KB CHR ROM in the file
+ * @return Decoded pattern tables
+ */
+const ppu::CTileCache &CROMImage::getTiles(std::size_t offset) const {
+	assert(offset + ppu::CTileCache::Tiles * ppu::CTileCache::TileSize <=
+	       m_Size);
+	std::call_once(m_TilesFlag, [this, offset] {
+		m_Tiles.reset(new ppu::CTileCache());
+		m_Tiles->updateAll(m_Data + offset);
+	});
+	return *m_Tiles;
+}
+
+/* CROMRegistry */
+
+/**
+ * Constructs the object
+ *
+ * @param hash Content hash function
+ */
+CROMRegistry::CROMRegistry(hash_t hash)
+    : m_Mutex(), m_Hash(hash), m_Images(), m_Files() {
+}
+
+/**
+ * Computes content hash
+ *
+ * @param image ROM image
+ * @return Hash value
+ */
+std::uint64_t CROMRegistry::getHash(const CROMImage &image) {
+	const std::uint8_t *data = image.getData();
+	std::size_t size = image.getSize();
+	std::uint64_t hash = 0xcbf29ce484222325 ^ size;
+	// FNV-1a over 64-bit words, the extra shift mixes high bits down
+	for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+		std::uint64_t word;
+		std::memcpy(&word, data, sizeof(word));
+		data += sizeof(word);
+		hash = (hash ^ word) * 0x100000001b3;
+		hash ^= hash >> 29;
+	}
+	for (; size > 0; size--) {
+		hash = (hash ^ *data++) * 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * Loads an image or reuses one with the same contents
+ *
+ * A file already seen with the same identity is reused without being read.
+ * Other files are mapped and hashed, so a copy of a loaded ROM costs one
+ * pass over the file the first time it is seen.
+ *
+ * @param fileName File path
+ * @return Shared image
+ */
+std::shared_ptr<const CROMImage> CROMRegistry::getImage(
+    const std::string &fileName) {
+	SFileID fileID;
+	if (readFileID(fileName, fileID)) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto iter = m_Files.find(fileID);
+		if (iter != m_Files.end()) {
+			std::shared_ptr<const CROMImage> loaded = iter->second.lock();
+			if (loaded) {
+				return loaded;
+			}
+		}
+	}
+	auto image = std::make_shared<const CROMImage>(fileName);
+	std::uint64_t hash = m_Hash(*image);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto range = m_Images.equal_range(hash);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		std::shared_ptr<const CROMImage> loaded = iter->second.lock();
+		if (loaded && loaded->getSize() == image->getSize() &&
+		    (image->getSize() == 0 ||
+		        std::memcmp(loaded->getData(), image->getData(),
+		            image->getSize()) == 0)) {
+			// The identity comes from the mapped file, not from the path
+			m_Files[image->getFileID()] = loaded;
+			return loaded;
+		}
+	}
+	// Drop images that are no longer used before adding a new one
+	for (auto iter = m_Images.begin(); iter != m_Images.end();) {
+		if (iter->second.expired()) {
+			iter = m_Images.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+	for (auto iter = m_Files.begin(); iter != m_Files.end();) {
+		if (iter->second.expired()) {
+			iter = m_Files.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+	m_Images.emplace(hash, image);
+	m_Files[image->getFileID()] = image;
+	return image;
+}
+
+/**
+ * Gets number of registered images
+ *
+ * Images that are no longer used are counted until the next new image is
+ * added.
+ *
+ * @return Number of images
+ */
+std::size_t CROMRegistry::getCount() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Images.size();
+}
+
+/**
+ * Gets process-wide registry
+ *
+ * @return Registry
+ */
+CROMRegistry &CROMRegistry::getRegistry() {
+	static CROMRegistry registry;
+	return registry;
+}
+
+}  // namespace core
+
+}  // namespace vpnes
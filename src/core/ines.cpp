@@ -27,12 +27,13 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <stdexcept>
-#include <fstream>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/core/config.hpp>
+#include <vpnes/core/image.hpp>
 #include <vpnes/core/ines.hpp>
 
 namespace vpnes {
@@ -46,14 +47,21 @@ namespace ines {
 /**
  * Constructs the structure from the data
  *
- * @param ROM
+ * @param ROM ROM image
  */
-SNESData::SNESData(std::ifstream *ROM) : PRG(), CHR(), Trainer() {
+SNESData::SNESData(const CROMImage &ROM) : PRG(), CHR(), Trainer() {
 	const char *iNESSignature = "NES\32";
 	uint8_t mapper;
 	iNES_Header header;
+	const std::uint8_t *data = ROM.getData();
+	std::size_t size = ROM.getSize();
 
-	ROM->read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (size < sizeof(header)) {
+		throw std::invalid_argument("Unknown file format");
+	}
+	std::memcpy(&header, data, sizeof(header));
+	data += sizeof(header);
+	size -= sizeof(header);
 	if (strncmp(header.Signature, iNESSignature, 4)) {
 		throw std::invalid_argument("Unknown file format");
 	}
@@ -90,17 +98,16 @@ SNESData::SNESData(std::ifstream *ROM) : PRG(), CHR(), Trainer() {
 		              ? 0x2000
 		              : header.RAMSize * 0x2000;
 	}
-	if (header.Flags & 0x04) {
-		Trainer.resize(0x0200);
-		ROM->read(
-		    reinterpret_cast<char *>(Trainer.data()), 0x0200 * sizeof(uint8_t));
+	std::size_t trainerSize = (header.Flags & 0x04) ? 0x0200 : 0;
+	if (size < trainerSize + PRGSize + CHRSize) {
+		throw std::invalid_argument("Unexpected end of file");
 	}
-	PRG.resize(PRGSize);
-	ROM->read(reinterpret_cast<char *>(PRG.data()), PRGSize * sizeof(uint8_t));
+	Trainer.assign(data, data + trainerSize);
+	data += trainerSize;
+	// ROM data is used in place, only the trainer is copied
+	PRG = data;
 	if (CHRSize) {
-		CHR.resize(CHRSize);
-		ROM->read(
-		    reinterpret_cast<char *>(CHR.data()), CHRSize * sizeof(uint8_t));
+		CHR = data + PRGSize;
 	}
 	switch (mapper) {
 	case 0:
@@ -27,6 +27,7 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
 #include <stdexcept>
 #include <vector>
 #include <vpnes/vpnes.hpp>
@@ -63,20 +64,26 @@ CNES *factoryNROM(const SNESConfig &config, CFrontEnd *frontEnd) {
  * @param config NES config
  */
 CNROM::CNROM(CMotherBoard *motherBoard, const SNESConfig &config)
-    : m_PRG(config.PRG)
+    : m_Image(config.Image)
+    , m_PRG(config.PRG)
+    , m_PRGSize(config.PRGSize)
     , m_CHR(config.CHR)
+    , m_CHRRAM()
     , m_RAM(config.RAMSize)
     , m_Mirroring(config.Mirroring) {
-	if (m_CHR.size() == 0) {
-		m_CHR.assign(0x2000, 0);
+	std::size_t chrSize = config.CHRSize;
+	if (chrSize == 0) {
+		m_CHRRAM.assign(0x2000, 0);
+		m_CHR = m_CHRRAM.data();
+		chrSize = m_CHRRAM.size();
 		m_CHRBank = 1;
 	} else {
 		m_CHRBank = 0;
 	}
-	if ((m_PRG.size() != 0x4000 && m_PRG.size() != 0x8000) ||
+	if ((m_PRGSize != 0x4000 && m_PRGSize != 0x8000) ||
 	    (m_Mirroring != MirroringHorizontal &&
 	        m_Mirroring != MirroringVertical) ||
-	    m_CHR.size() != 0x2000 || m_RAM.size() > 0x2000 ||
+	    chrSize != 0x2000 || m_RAM.size() > 0x2000 ||
 	    (m_RAM.size() & 0x07ff)) {
 		throw std::invalid_argument("Invalid ROM parameters");
 	}
@@ -0,0 +1,121 @@
+/**
+ * @file
+ *
+ * Implements worker thread pool
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/workers.hpp>
+
+namespace vpnes {
+
+namespace core {
+
+/* CWorkerPool */
+
+/**
+ * Constructs the object
+ *
+ * @param threads Number of threads
+ */
+CWorkerPool::CWorkerPool(std::size_t threads)
+    : m_Threads()
+    , m_Jobs()
+    , m_Running(0)
+    , m_Stopping(false)
+    , m_Mutex()
+    , m_JobAdded()
+    , m_JobDone() {
+	for (std::size_t i = 0; i < threads; i++) {
+		m_Threads.emplace_back(&CWorkerPool::work, this);
+	}
+}
+
+/**
+ * Waits for the running jobs and stops the threads
+ */
+CWorkerPool::~CWorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_Jobs.clear();
+	}
+	m_JobAdded.notify_all();
+	for (auto &thread : m_Threads) {
+		thread.join();
+	}
+}
+
+/**
+ * Worker thread routine
+ */
+void CWorkerPool::work() {
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;) {
+		m_JobAdded.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+		if (m_Stopping) {
+			break;
+		}
+		job_t job = std::move(m_Jobs.front());
+		m_Jobs.pop_front();
+		m_Running++;
+		lock.unlock();
+		job();
+		lock.lock();
+		if (--m_Running == 0 && m_Jobs.empty()) {
+			m_JobDone.notify_all();
+		}
+	}
+}
+
+/**
+ * Queues a job
+ *
+ * @param job Job
+ */
+void CWorkerPool::addJob(job_t job) {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(std::move(job));
+	}
+	m_JobAdded.notify_one();
+}
+
+/**
+ * Waits until all queued jobs are done
+ */
+void CWorkerPool::wait() {
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_JobDone.wait(lock, [this] { return m_Running == 0 && m_Jobs.empty(); });
+}
+
+}  // namespace core
+
+}  // namespace vpnes
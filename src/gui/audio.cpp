@@ -0,0 +1,169 @@
+/**
+ * @file
+ *
+ * Implements audio output
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/audio.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/* CAudioOutput */
+
+/**
+ * Opens audio device
+ *
+ * @param rate Requested sample rate
+ * @param clockSource Device clock paces emulation
+ */
+CAudioOutput::CAudioOutput(int rate, bool clockSource)
+    : m_Device()
+    , m_Rate()
+    , m_ClockSource(clockSource)
+    , m_Ring()
+    , m_RateControl(TargetFill)
+    , m_Playing(false)
+    , m_Stalled(false)
+    , m_StallPosition(0)
+    , m_LastSample(0) {
+	::SDL_AudioSpec desired = {};
+	::SDL_AudioSpec obtained = {};
+	desired.freq = rate;
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 1;
+	desired.samples = DeviceSamples;
+	desired.callback = callback;
+	desired.userdata = this;
+	m_Device = ::SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained,
+	    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	if (!m_Device) {
+		throw std::invalid_argument(SDL_GetError());
+	}
+	m_Rate = obtained.freq;
+}
+
+/**
+ * Closes audio device
+ */
+CAudioOutput::~CAudioOutput() {
+	::SDL_CloseAudioDevice(m_Device);
+}
+
+/**
+ * Device callback
+ *
+ * @param userData Audio output
+ * @param stream Output buffer
+ * @param len Buffer size in bytes
+ */
+void SDLCALL CAudioOutput::callback(void *userData, ::Uint8 *stream, int len) {
+	CAudioOutput *output = static_cast<CAudioOutput *>(userData);
+	std::int16_t *samples = reinterpret_cast<std::int16_t *>(stream);
+	std::size_t count = len / sizeof(std::int16_t);
+	std::size_t read = output->m_Ring.read(samples, count);
+	if (read > 0) {
+		output->m_LastSample = samples[read - 1];
+	}
+	// Holding the level makes an underrun a gap rather than a click
+	std::fill(samples + read, samples + count, output->m_LastSample);
+}
+
+/**
+ * Queues samples and updates rate control
+ *
+ * @param samples Samples
+ * @param count Number of samples
+ */
+void CAudioOutput::write(const std::int16_t *samples, std::size_t count) {
+	// Overflowing samples are dropped
+	m_Ring.write(samples, count);
+	std::size_t fill = m_Ring.getCount();
+	if (!m_Playing && fill >= TargetFill) {
+		m_Playing = true;
+		::SDL_PauseAudioDevice(m_Device, 0);
+	}
+	if (m_Playing && !m_ClockSource) {
+		m_RateControl.update(fill);
+	}
+}
+
+/**
+ * Blocks until the device drains the ring (if it is the clock source)
+ *
+ * The wait is bounded by a few callbacks past the expected drain time, so
+ * a stuck device cannot hang emulation. It is not waited for again until
+ * it plays another callback buffer.
+ *
+ * @return False if the device did not pace emulation
+ */
+bool CAudioOutput::wait() {
+	if (!m_ClockSource || !m_Playing) {
+		return false;
+	}
+	if (m_Stalled) {
+		if (m_Ring.getReadCount() - m_StallPosition < DeviceSamples) {
+			return false;
+		}
+		m_Stalled = false;
+	}
+	std::size_t fill = m_Ring.getCount();
+	if (fill <= SyncFill) {
+		return true;
+	}
+	std::chrono::steady_clock::time_point deadline =
+	    std::chrono::steady_clock::now() +
+	    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	        std::chrono::duration<double>(
+	            (fill - SyncFill + WaitBuffers * DeviceSamples) / m_Rate));
+	do {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			m_Stalled = true;
+			m_StallPosition = m_Ring.getReadCount();
+			return false;
+		}
+		// The device drains whole callback buffers, so this may take a few
+		// rounds
+		std::this_thread::sleep_for(
+		    std::chrono::duration<double>((fill - SyncFill) / m_Rate));
+		fill = m_Ring.getCount();
+	} while (fill > SyncFill);
+	return true;
+}
+
+}  // namespace gui
+
+}  // namespace vpnes
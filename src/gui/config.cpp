@@ -27,8 +27,10 @@
 #include "config.h"
 #endif
 
-#include <cassert>
+#include <cstddef>
 #include <cstring>
+#include <stdexcept>
+#include <string>
 #include <iostream>
 #include <vpnes/gui/config.hpp>
 
@@ -41,33 +43,119 @@ namespace gui {
 /**
  * Sets default values
  */
-SApplicationConfig::SApplicationConfig() : inputFile() {
+SApplicationConfig::SApplicationConfig()
+    : inputFile()
+    , profile("accurate")
+    , frameSkip(1)
+    , ntscFilter(false)
+    , scaler("nearest")
+    , vsync(false)
+    , pacingStats(false)
+    , sampleRate(48000)
+    , audioSync(false) {
 }
 
 /**
- * Parses command line options
+ * Parse command line option
  *
- * @param argc Amount of parameters
- * @param argv Array of parameters
+ * @param name Option name
+ * @param value Argument
+ * @return Valid option or not
  */
-void SApplicationConfig::parseOptions(int argc, char **argv) {
-	// TODO(me): Implement parsing
-	if (argc >= 2) {
-		setInputFile(argv[1]);
+bool SApplicationConfig::parseOption(
+    const std::string &name, const std::string &value) {
+	if (name == "profile") {
+		profile = value;
+		return true;
+	} else if (name == "frameskip") {
+		std::size_t pos = 0;
+		int skip = 0;
+		try {
+			skip = std::stoi(value, &pos);
+		} catch (const std::logic_error &) {
+			skip = 0;
+		}
+		if (skip < 1 || pos != value.size()) {
+			throw std::invalid_argument("Invalid frame skip: " + value);
+		}
+		frameSkip = skip;
+		return true;
+	} else if (name == "scaler") {
+		scaler = value;
+		return true;
+	} else if (name == "sample-rate") {
+		std::size_t pos = 0;
+		int rate = -1;
+		try {
+			rate = std::stoi(value, &pos);
+		} catch (const std::logic_error &) {
+			rate = -1;
+		}
+		if (rate < 0 || pos != value.size()) {
+			throw std::invalid_argument("Invalid sample rate: " + value);
+		}
+		sampleRate = rate;
+		return true;
+	} else if (name == "sync") {
+		if (value == "time") {
+			audioSync = false;
+		} else if (value == "audio") {
+			audioSync = true;
+		} else {
+			throw std::invalid_argument("Unknown sync mode: " + value);
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Parse command line option
+ *
+ * @param name Option name
+ * @return Valid option or not
+ */
+bool SApplicationConfig::parseOption(const std::string &name) {
+	if (name == "ntsc") {
+		ntscFilter = true;
+		return true;
+	} else if (name == "vsync") {
+		vsync = true;
+		return true;
+	} else if (name == "pacing-stats") {
+		pacingStats = true;
+		return true;
 	}
+	return false;
 }
 
 /**
- * Opens input file and constructs ifstream object
+ * Parses command line options
+ *
+ * Options are passed as --name=value or --name, anything else is
+ * treated as the input file
  *
- * @return std::ifstream for reading file
+ * @param argc Amount of parameters
+ * @param argv Array of parameters
  */
-std::ifstream SApplicationConfig::getInputFile() {
-	assert(inputFile.size() > 0);
-	std::ifstream file;
-	file.exceptions(file.exceptions() | std::fstream::failbit);
-	file.open(inputFile, std::fstream::binary);
-	return file;
+void SApplicationConfig::parseOptions(int argc, char **argv) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0) {
+			setInputFile(argv[i]);
+			continue;
+		}
+		std::string::size_type pos = arg.find('=');
+		bool valid;
+		if (pos == std::string::npos) {
+			valid = parseOption(arg.substr(2));
+		} else {
+			valid = parseOption(arg.substr(2, pos - 2), arg.substr(pos + 1));
+		}
+		if (!valid) {
+			throw std::invalid_argument("Unknown option: " + arg);
+		}
+	}
 }
 
 }  // namespace gui
@@ -28,6 +28,7 @@
 #endif
 
 #include <SDL.h>
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <cstdlib>
@@ -38,11 +39,16 @@
 #include <chrono>
 #include <thread>
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/gui/config.hpp>
+#include <vpnes/gui/audio.hpp>
+#include <vpnes/gui/buffers.hpp>
 #include <vpnes/gui/gui.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/gui/ntsc.hpp>
+#include <vpnes/gui/pacer.hpp>
+#include <vpnes/gui/scaler.hpp>
 #include <vpnes/core/config.hpp>
 #include <vpnes/core/nes.hpp>
 
@@ -56,13 +62,31 @@ namespace gui {
  * Constructor
  */
 CGUI::CGUI()
-    : m_Jitter()
-    , m_TimeOverhead()
+    : m_Pacer()
     , m_Time()
     , m_Config()
     , m_Window()
     , m_Renderer()
-    , m_ScreenBuffer() {
+    , m_ScreenBuffer()
+    , m_FrameConverter()
+    , m_NTSCFilter()
+    , m_Scaler()
+    , m_Audio()
+    , m_Frames(core::frame::Width * core::frame::Height)
+    , m_Events()
+    , m_ScaledBuffer()
+    , m_ConvertedBuffer()
+    , m_Pixels()
+    , m_PixelsPitch(0)
+    , m_Stopped(false)
+    , m_QuitRequested(false)
+#ifdef VPNES_MEASURE_FPS
+    , m_FPS(0)
+#endif
+    , m_EmulationThread()
+    , m_SkippedFrames(0)
+    , m_FrameShown(false)
+    , m_AudioPaced(false) {
 	std::atexit(::SDL_Quit);
 }
 
@@ -87,29 +111,88 @@ void CGUI::initMainWindow(std::size_t width, std::size_t height) {
 		if (!m_Window) {
 			throw std::invalid_argument(SDL_GetError());
 		}
-		m_Renderer = ::SDL_CreateRenderer(m_Window, -1,
-		    SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+		Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+		if (m_Config.isVSyncEnabled()) {
+			flags |= SDL_RENDERER_PRESENTVSYNC;
+		}
+		m_Renderer = ::SDL_CreateRenderer(m_Window, -1, flags);
 		if (!m_Renderer) {
 			throw std::invalid_argument(SDL_GetError());
 		}
+		::SDL_DisplayMode mode;
+		if (m_Config.isVSyncEnabled() &&
+		    ::SDL_GetWindowDisplayMode(m_Window, &mode) == 0 &&
+		    mode.refresh_rate > 0) {
+			m_Pacer.lockToRefresh(1000.0 / mode.refresh_rate);
+		}
 	} else {
 		::SDL_DestroyTexture(m_ScreenBuffer);
 		::SDL_SetWindowSize(m_Window, width, height);
 	}
-	int realWidth, realHeight;
-	Uint32 pixelFormat;
-	::SDL_GetRendererOutputSize(m_Renderer, &realWidth, &realHeight);
-	pixelFormat = ::SDL_GetWindowPixelFormat(m_Window);
-	if (pixelFormat == SDL_PIXELFORMAT_UNKNOWN) {
+	Uint32 pixelFormat = ::SDL_GetWindowPixelFormat(m_Window);
+	// Pick the converter output closest to the window to avoid conversions
+	// in SDL
+	// Filters that blend colors need 32-bit pixels
+	bool trueColor =
+	    m_Config.isNTSCFilterEnabled() || m_Scaler->isHostScaler();
+	if (pixelFormat == SDL_PIXELFORMAT_RGB565 && !trueColor) {
+		m_FrameConverter.reset(
+		    new CFrameConverter(CFrameConverter::PixelFormatRGB565));
+	} else if (pixelFormat == SDL_PIXELFORMAT_BGRA32 ||
+	           (SDL_BYTEORDER == SDL_LIL_ENDIAN &&
+	               pixelFormat == SDL_PIXELFORMAT_RGB888)) {
+		pixelFormat = SDL_PIXELFORMAT_BGRA32;
+		m_FrameConverter.reset(
+		    new CFrameConverter(CFrameConverter::PixelFormatBGRA32));
+	} else {
 		pixelFormat = SDL_PIXELFORMAT_RGBA32;
+		m_FrameConverter.reset(
+		    new CFrameConverter(CFrameConverter::PixelFormatRGBA32));
 	}
+	std::size_t textureWidth = m_Scaler->getWidth();
+	std::size_t textureHeight = m_Scaler->getHeight();
+	// The filter has its own horizontal resolution and takes precedence
+	if (m_Config.isNTSCFilterEnabled()) {
+		m_NTSCFilter.reset(new CNTSCFilter(m_FrameConverter->getFormat()));
+		textureWidth = CNTSCFilter::Width;
+		textureHeight = CNTSCFilter::Height;
+	} else if (m_Scaler->isHostScaler()) {
+		m_ConvertedBuffer.reset(
+		    new std::uint32_t[core::frame::Width * core::frame::Height]);
+	} else {
+		m_ScaledBuffer.reset(new std::uint16_t[textureWidth * textureHeight]);
+	}
+	m_PixelsPitch = textureWidth * m_FrameConverter->getPixelSize();
+	m_Pixels.reset(new std::uint8_t[m_PixelsPitch * textureHeight]);
 	m_ScreenBuffer = ::SDL_CreateTexture(m_Renderer, pixelFormat,
-	    SDL_RENDERER_TARGETTEXTURE, realWidth, realHeight);
+	    SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
 	if (!m_ScreenBuffer) {
 		throw std::invalid_argument(SDL_GetError());
 	}
 }
 
+/**
+ * Converts frame to host pixels
+ *
+ * @param frameBuffer Frame
+ */
+void CGUI::processFrame(const std::uint16_t *frameBuffer) {
+	if (m_NTSCFilter) {
+		m_NTSCFilter->filter(frameBuffer, m_Pixels.get(), m_PixelsPitch);
+	} else if (m_ConvertedBuffer) {
+		m_FrameConverter->convert(frameBuffer, m_ConvertedBuffer.get(),
+		    core::frame::Width * sizeof(std::uint32_t));
+		m_Scaler->scale(m_ConvertedBuffer.get(), m_Pixels.get(),
+		    m_PixelsPitch, m_FrameConverter->getFormat());
+	} else if (m_Scaler->getFactor() > 1) {
+		m_Scaler->scale(frameBuffer, m_ScaledBuffer.get());
+		m_FrameConverter->convert(m_ScaledBuffer.get(), m_Scaler->getWidth(),
+		    m_Scaler->getHeight(), m_Pixels.get(), m_PixelsPitch);
+	} else {
+		m_FrameConverter->convert(frameBuffer, m_Pixels.get(), m_PixelsPitch);
+	}
+}
+
 /**
  * Starts GUI
  *
@@ -118,26 +201,53 @@ void CGUI::initMainWindow(std::size_t width, std::size_t height) {
  * @return Exit code
  */
 int CGUI::startGUI(int argc, char **argv) {
-	m_Config.parseOptions(argc, argv);
+	try {
+		m_Config.parseOptions(argc, argv);
+		m_Scaler.reset(new CScaler(m_Config.getScaler()));
+	} catch (const std::invalid_argument &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
 	if (!m_Config.hasInputFile()) {
 		std::cerr << "Usage:" << std::endl;
-		std::cerr << argv[0] << " path_to_rom.nes" << std::endl;
+		std::cerr << argv[0] << " [--profile=accurate|fast|threaded]"
+		          << " [--frameskip=n] [--ntsc]"
+		          << " [--scaler=nearest|scale2x|scale3x|hq2x|xbr]"
+		          << " [--vsync] [--pacing-stats] [--sample-rate=n]"
+		          << " [--sync=time|audio]"
+		          << " path_to_rom.nes" << std::endl;
 		return 0;
 	}
 	try {
 		if (::SDL_Init(SDL_INIT_EVERYTHING) < 0) {
 			throw std::invalid_argument(SDL_GetError());
 		}
-		std::ifstream inputFile = m_Config.getInputFile();
 		core::SNESConfig nesConfig;
-		nesConfig.configure(m_Config, &inputFile);
-		inputFile.close();
-		initMainWindow(512, 448);
+		nesConfig.configure(m_Config);
+		std::size_t windowScale =
+		    std::max<std::size_t>(m_Scaler->getFactor(), 2);
+		initMainWindow(256 * windowScale, 224 * windowScale);
+		if (m_Config.getSampleRate() > 0) {
+			try {
+				m_Audio.reset(new CAudioOutput(
+				    m_Config.getSampleRate(), m_Config.isAudioSyncEnabled()));
+			} catch (const std::invalid_argument &e) {
+				std::cerr << "No audio: " << e.what() << std::endl;
+			}
+		}
 		m_NES.reset(nesConfig.createInstance(this));
-		m_Jitter = 0;
-		m_TimeOverhead = 0;
 		m_Time = std::chrono::high_resolution_clock::now();
-		m_NES->powerUp();
+		m_EmulationThread = std::thread(&CGUI::emulate, this);
+		present();
+		m_EmulationThread.join();
+		m_Audio.reset();
+		if (m_Config.isPacingStatsEnabled()) {
+			CFramePacer::SStatistics statistics = m_Pacer.getStatistics();
+			std::cerr << "Frames: " << statistics.Frames << std::endl;
+			std::cerr << "Frame time error, ms: mean " << statistics.Mean
+			          << ", deviation " << statistics.Deviation << ", max "
+			          << statistics.Max << std::endl;
+		}
 	} catch (const std::invalid_argument &e) {
 		std::cerr << e.what() << std::endl;
 	} catch (const std::exception &e) {
@@ -147,6 +257,82 @@ int CGUI::startGUI(int argc, char **argv) {
 	return EXIT_SUCCESS;
 }
 
+/**
+ * Emulation thread routine
+ */
+void CGUI::emulate() {
+	try {
+		m_NES->powerUp();
+	} catch (const std::invalid_argument &e) {
+		std::cerr << e.what() << std::endl;
+	} catch (const std::exception &e) {
+		std::cerr << "Unknown error: " << e.what() << std::endl;
+		std::cerr << std::strerror(errno) << std::endl;
+	}
+	m_Stopped = true;
+}
+
+/**
+ * Presents frames and collects input until emulation finishes
+ */
+void CGUI::present() {
+#ifdef VPNES_MEASURE_FPS
+	double shownFPS = 0;
+#endif
+	while (!m_Stopped) {
+		::SDL_Event event;
+		while (::SDL_PollEvent(&event)) {
+			switch (event.type) {
+			case SDL_QUIT:
+				// Kept out of the queue so it cannot be dropped
+				m_QuitRequested = true;
+				break;
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				// Input is dropped if emulation does not keep up
+				m_Events.push(event);
+				break;
+			}
+		}
+#ifdef VPNES_MEASURE_FPS
+		if (m_FPS != shownFPS) {
+			shownFPS = m_FPS;
+			std::stringstream ss;
+			ss << "FPS: " << shownFPS;
+			::SDL_SetWindowTitle(m_Window, ss.str().c_str());
+		}
+#endif
+		if (!m_Frames.update()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		processFrame(m_Frames.getFront());
+		::SDL_UpdateTexture(
+		    m_ScreenBuffer, nullptr, m_Pixels.get(), m_PixelsPitch);
+		::SDL_RenderCopy(m_Renderer, m_ScreenBuffer, nullptr, nullptr);
+		::SDL_RenderPresent(m_Renderer);
+		if (m_Config.isVSyncEnabled()) {
+			m_Pacer.handleVSync();
+		}
+	}
+}
+
+/**
+ * Gets buffer for the next frame
+ *
+ * @return Frame buffer or nullptr if the frame is skipped
+ */
+std::uint16_t *CGUI::getFrameBuffer() {
+	if (m_SkippedFrames > 0) {
+		m_SkippedFrames--;
+		m_FrameShown = false;
+		return nullptr;
+	}
+	m_SkippedFrames = m_Config.getFrameSkip() - 1;
+	m_FrameShown = true;
+	return m_Frames.getBack();
+}
+
 /**
  * Frame-ready callback
  *
@@ -154,14 +340,14 @@ int CGUI::startGUI(int argc, char **argv) {
  */
 void CGUI::handleFrameRender(double frameTime) {
 	::SDL_Event event;
-	::SDL_RenderCopy(m_Renderer, m_ScreenBuffer, nullptr, nullptr);
-	::SDL_RenderPresent(m_Renderer);
-	while (::SDL_PollEvent(&event)) {
-		switch (event.type) {
-		case SDL_QUIT:
-			m_NES->turnOff();
-			break;
-		}
+	if (m_FrameShown) {
+		m_Frames.publish();
+	}
+	if (m_QuitRequested) {
+		m_NES->turnOff();
+	}
+	// Keys are not mapped to controllers yet
+	while (m_Events.pop(event)) {
 	}
 #ifdef VPNES_MEASURE_FPS
 	static int curFrame = 0;
@@ -173,37 +359,42 @@ void CGUI::handleFrameRender(double frameTime) {
 	        newTime - lastTime)
 	        .count() > 1000) {
 		m_Time = newTime;
-		std::stringstream ss;
-		ss << "FPS: "
-		   << curFrame * 1000.0 /
-		          std::chrono::duration_cast<std::chrono::milliseconds>(
-		              newTime - lastTime)
-		              .count();
-		::SDL_SetWindowTitle(m_Window, ss.str().c_str());
+		m_FPS = curFrame * 1000.0 /
+		        std::chrono::duration_cast<std::chrono::milliseconds>(
+		            newTime - lastTime)
+		            .count();
 		curFrame = 0;
 	}
 #else
-	std::chrono::high_resolution_clock::time_point lastTime = m_Time;
-	m_Jitter += frameTime;
-	if (m_Jitter > m_TimeOverhead) {
-		int64_t waitTime = static_cast<std::int64_t>(m_Jitter - m_TimeOverhead);
-		std::this_thread::sleep_for(std::chrono::milliseconds(waitTime));
-		m_Time = std::chrono::high_resolution_clock::now();
-		int64_t actualWait = static_cast<std::int64_t>(
-		    std::chrono::duration_cast<std::chrono::milliseconds>(
-		        m_Time - lastTime)
-		        .count());
-		m_TimeOverhead += (actualWait - waitTime) / 2;
-		m_Jitter -= actualWait;
-	} else {
-		m_Time = std::chrono::high_resolution_clock::now();
-		m_Jitter -= std::chrono::duration_cast<std::chrono::milliseconds>(
-		    m_Time - lastTime)
-		                .count();
+	// Audio clock paces emulation in handleAudio() unless the device stalls
+	if (!m_Audio || !m_Config.isAudioSyncEnabled() || !m_AudioPaced) {
+		m_Pacer.wait(frameTime);
 	}
 #endif
 }
 
+/**
+ * Gets audio sample rate
+ *
+ * @return Sample rate or 0 if audio is disabled
+ */
+double CGUI::getSampleRate() {
+	return m_Audio ? m_Audio->getSampleRate() : 0;
+}
+
+/**
+ * Audio block callback
+ *
+ * @param samples Samples
+ * @param count Number of samples
+ */
+void CGUI::handleAudio(const std::int16_t *samples, std::size_t count) {
+	m_Audio->write(samples, count);
+#ifndef VPNES_MEASURE_FPS
+	m_AudioPaced = m_Audio->wait();
+#endif
+}
+
 }  // namespace gui
 
 }  // namespace vpnes
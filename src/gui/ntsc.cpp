@@ -0,0 +1,249 @@
+/**
+ * @file
+ *
+ * Implements NTSC composite video filter
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/ntsc.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/core/frontend.hpp>
+#include <vpnes/core/workers.hpp>
+
+#ifdef VPNES_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * Signal levels (low levels, then high levels) relative to sync
+ */
+const double signalLevels[8] = {
+    0.350, 0.518, 0.962, 1.550, 1.094, 1.506, 1.962, 1.962};
+
+/**
+ * Signal parameters
+ */
+const double signalBlack = 0.518, signalWhite = 1.962,
+             signalAttenuation = 0.746;
+
+/**
+ * Hue shift of the decoder in samples
+ */
+const double decoderHue = 3.9;
+
+/**
+ * NES color on both sides of the picture
+ */
+const std::uint16_t borderColor = 0x0f;
+
+/* CNTSCFilter */
+
+/**
+ * Generates signal sample
+ *
+ * @param pixel NES color with emphasis
+ * @param phase Subcarrier phase of the sample (0-11)
+ * @return Signal level (0 is black, 1 is white)
+ */
+double CNTSCFilter::getSignal(std::size_t pixel, std::size_t phase) {
+	std::size_t color = pixel & 0x0f;
+	std::size_t level = (pixel >> 4) & 0x03;
+	std::size_t emphasis = pixel >> core::frame::EmphasisShift;
+	if (color > 0x0d) {
+		level = 1;
+	}
+	double low = signalLevels[level];
+	double high = signalLevels[level + 4];
+	if (color == 0x00) {
+		low = high;
+	} else if (color > 0x0c) {
+		high = low;
+	}
+	auto inPhase = [phase](std::size_t color) {
+		return (color + phase) % 12 < 6;
+	};
+	double signal = inPhase(color) ? high : low;
+	if (((emphasis & 0x01) && inPhase(0)) ||
+	    ((emphasis & 0x02) && inPhase(4)) ||
+	    ((emphasis & 0x04) && inPhase(8))) {
+		signal *= signalAttenuation;
+	}
+	return (signal - signalBlack) / (signalWhite - signalBlack);
+}
+
+/**
+ * Constructs the object
+ *
+ * @param format Pixel format (32-bit only)
+ */
+CNTSCFilter::CNTSCFilter(CFrameConverter::EPixelFormat format)
+    : m_Format(format)
+    , m_Table()
+    , m_FramePhase(0)
+    , m_Workers(std::max(std::thread::hardware_concurrency(), 1u)) {
+	if (m_Format == CFrameConverter::PixelFormatRGB565) {
+		throw std::invalid_argument("NTSC filter needs 32-bit pixels");
+	}
+	const double pi = std::acos(-1.0);
+	for (std::size_t phase = 0; phase < Phases; phase++) {
+		for (std::size_t pixel = 0; pixel < core::frame::Colors; pixel++) {
+			double yiq[Parts][3] = {};
+			for (std::size_t sample = 0; sample < 8; sample++) {
+				std::size_t position = phase * 4 + sample;
+				double signal = getSignal(pixel, position % 12);
+				double angle = pi * (position + decoderHue) / 6;
+				double value[3] = {signal / 12, signal * std::cos(angle) / 6,
+				    signal * std::sin(angle) / 6};
+				for (std::size_t i = 0; i < 3; i++) {
+					yiq[PartFull][i] += value[i];
+					yiq[(sample < 4) ? PartHead : PartTail][i] += value[i];
+				}
+			}
+			for (std::size_t part = 0; part < Parts; part++) {
+				double y = yiq[part][0], i = yiq[part][1], q = yiq[part][2];
+				double rgb[3] = {y + 0.946882 * i + 0.623557 * q,
+				    y - 0.274788 * i - 0.635691 * q,
+				    y - 1.108545 * i + 1.709007 * q};
+				// Alpha adds up to opaque for any pair of parts
+				double alpha = (part == PartFull) ? 2.0 / 3 : 1.0 / 3;
+				double channels[Channels] = {rgb[0], rgb[1], rgb[2], alpha};
+				if (m_Format == CFrameConverter::PixelFormatBGRA32) {
+					std::swap(channels[0], channels[2]);
+				}
+				for (std::size_t channel = 0; channel < Channels; channel++) {
+					m_Table[phase][pixel][part][channel] =
+					    static_cast<std::int16_t>(std::lround(
+					        channels[channel] * (255 << FixedShift)));
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Filters a line
+ *
+ * @param src Source line
+ * @param dst Output line
+ * @param phase Subcarrier phase of the first pixel
+ */
+void CNTSCFilter::filterLine(
+    const std::uint16_t *src, std::uint32_t *dst, std::size_t phase) const {
+	// Phase advances by 8 samples (2 steps of 4) per pixel
+	std::size_t prevPhase = (phase + Phases - 2) % Phases;
+	std::size_t nextPhase = (phase + 2) % Phases;
+	for (std::size_t x = 0; x < core::frame::Width; x++) {
+		std::uint16_t prev = (x > 0) ? src[x - 1] : borderColor;
+		std::uint16_t next =
+		    (x < core::frame::Width - 1) ? src[x + 1] : borderColor;
+		const std::int16_t *full = m_Table[phase][src[x]][PartFull];
+		const std::int16_t *tail = m_Table[prevPhase][prev][PartTail];
+		const std::int16_t *head = m_Table[nextPhase][next][PartHead];
+#ifdef VPNES_SSE2
+		__m128i center =
+		    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(full));
+		__m128i sides = _mm_unpacklo_epi64(
+		    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(tail)),
+		    _mm_loadl_epi64(reinterpret_cast<const __m128i *>(head)));
+		__m128i sum = _mm_srai_epi16(
+		    _mm_adds_epi16(_mm_unpacklo_epi64(center, center), sides),
+		    FixedShift);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x * 2),
+		    _mm_packus_epi16(sum, sum));
+#else
+		std::uint8_t bytes[2][Channels];
+		for (std::size_t channel = 0; channel < Channels; channel++) {
+			int left = (full[channel] + tail[channel]) >> FixedShift;
+			int right = (full[channel] + head[channel]) >> FixedShift;
+			bytes[0][channel] = std::min(std::max(left, 0), 255);
+			bytes[1][channel] = std::min(std::max(right, 0), 255);
+		}
+		std::memcpy(dst + x * 2, bytes, sizeof(bytes));
+#endif
+		prevPhase = phase;
+		phase = nextPhase;
+		nextPhase = (nextPhase + 2) % Phases;
+	}
+}
+
+/**
+ * Filters a band of lines
+ *
+ * @param frameBuffer Frame
+ * @param pixels Output pixels
+ * @param pitch Output line size in bytes
+ * @param first First line
+ * @param last Line after the last one
+ */
+void CNTSCFilter::filterLines(const std::uint16_t *frameBuffer, void *pixels,
+    std::size_t pitch, std::size_t first, std::size_t last) const {
+	std::uint8_t *line = static_cast<std::uint8_t *>(pixels) + first * pitch;
+	for (std::size_t y = first; y < last; y++) {
+		// Each line starts 4 samples later
+		filterLine(frameBuffer + y * core::frame::Width,
+		    reinterpret_cast<std::uint32_t *>(line),
+		    (y + m_FramePhase) % Phases);
+		line += pitch;
+	}
+}
+
+/**
+ * Filters frame
+ *
+ * @param frameBuffer Frame (core::frame::Width * core::frame::Height)
+ * @param pixels Output pixels (Width * Height)
+ * @param pitch Output line size in bytes
+ */
+void CNTSCFilter::filter(
+    const std::uint16_t *frameBuffer, void *pixels, std::size_t pitch) {
+	std::size_t bands = m_Workers.getSize();
+	std::size_t bandLines = (Height + bands - 1) / bands;
+	for (std::size_t first = 0; first < Height; first += bandLines) {
+		std::size_t last = std::min<std::size_t>(first + bandLines, Height);
+		m_Workers.addJob([this, frameBuffer, pixels, pitch, first, last]() {
+			filterLines(frameBuffer, pixels, pitch, first, last);
+		});
+	}
+	m_Workers.wait();
+	// Odd frames are a dot shorter, so the phase alternates
+	m_FramePhase ^= 1;
+}
+
+}  // namespace gui
+
+}  // namespace vpnes
@@ -0,0 +1,148 @@
+/**
+ * @file
+ *
+ * Implements frame pacing
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/pacer.hpp>
+
+namespace vpnes {
+
+namespace gui {
+
+/* CFramePacer */
+
+/**
+ * Constructs the object
+ */
+CFramePacer::CFramePacer()
+    : m_Deadline()
+    , m_LastFrame()
+    , m_Started(false)
+    , m_RefreshPeriod(0)
+    , m_LastVSync()
+    , m_Frames(0)
+    , m_ErrorSum(0)
+    , m_ErrorSquareSum(0)
+    , m_MaxError(0) {
+}
+
+/**
+ * Locks frame rate to display refresh rate
+ *
+ * @param period Refresh period in ms
+ */
+void CFramePacer::lockToRefresh(double period) {
+	m_RefreshPeriod = period;
+	m_LastVSync = std::chrono::steady_clock::now();
+}
+
+/**
+ * Refines refresh period after a present synchronized to vsync
+ */
+void CFramePacer::handleVSync() {
+	std::chrono::steady_clock::time_point now =
+	    std::chrono::steady_clock::now();
+	double interval =
+	    std::chrono::duration<double, std::milli>(now - m_LastVSync).count();
+	m_LastVSync = now;
+	double period = m_RefreshPeriod.load(std::memory_order_relaxed);
+	// Missed vsyncs are skipped, the rest follow the drift of display clock
+	if (period > 0 && std::abs(interval - period) * LockTolerance < period) {
+		m_RefreshPeriod.store(period + (interval - period) / RefreshSmoothing,
+		    std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Waits until the frame is due
+ *
+ * @param frameTime Emulated frame time in ms
+ */
+void CFramePacer::wait(double frameTime) {
+	std::chrono::steady_clock::time_point now =
+	    std::chrono::steady_clock::now();
+	if (!m_Started) {
+		m_Deadline = now;
+		m_LastFrame = now;
+		m_Started = true;
+	}
+	double period = frameTime;
+	double refresh = m_RefreshPeriod.load(std::memory_order_relaxed);
+	if (refresh > 0 &&
+	    std::abs(refresh - frameTime) * LockTolerance < frameTime) {
+		period = refresh;
+	}
+	m_Deadline += std::chrono::nanoseconds(
+	    static_cast<std::int64_t>(std::llround(period * 1000000.0)));
+	if (now - m_Deadline > std::chrono::nanoseconds(MaxLag)) {
+		// Too far behind to catch up, start over from now
+		m_Deadline = now;
+	} else {
+		if (m_Deadline - now > std::chrono::nanoseconds(SpinTime)) {
+			std::this_thread::sleep_for(
+			    m_Deadline - now - std::chrono::nanoseconds(SpinTime));
+		}
+		while ((now = std::chrono::steady_clock::now()) < m_Deadline) {
+			std::this_thread::yield();
+		}
+	}
+	double error =
+	    std::chrono::duration<double, std::milli>(now - m_LastFrame).count() -
+	    period;
+	m_LastFrame = now;
+	m_Frames++;
+	m_ErrorSum += error;
+	m_ErrorSquareSum += error * error;
+	m_MaxError = std::max(m_MaxError, std::abs(error));
+}
+
+/**
+ * Gets frame time statistics
+ *
+ * @return Statistics
+ */
+CFramePacer::SStatistics CFramePacer::getStatistics() const {
+	SStatistics statistics = {m_Frames, 0, 0, m_MaxError};
+	if (m_Frames > 0) {
+		statistics.Mean = m_ErrorSum / m_Frames;
+		statistics.Deviation = std::sqrt(std::max(0.0,
+		    m_ErrorSquareSum / m_Frames - statistics.Mean * statistics.Mean));
+	}
+	return statistics;
+}
+
+}  // namespace gui
+
+}  // namespace vpnes
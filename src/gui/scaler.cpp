@@ -0,0 +1,897 @@
+/**
+ * @file
+ *
+ * Implements pixel-art scalers
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/scaler.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/core/frontend.hpp>
+
+#ifdef VPNES_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace vpnes {
+
+namespace gui {
+
+#ifdef VPNES_SSE2
+/**
+ * Selects values by mask
+ *
+ * @param mask Mask
+ * @param a Values for set bits
+ * @param b Values for cleared bits
+ * @return Selected values
+ */
+inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Loads 8 pixels
+ *
+ * @param src Pixels
+ * @return Loaded pixels
+ */
+inline __m128i load(const std::uint16_t *src) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+/**
+ * Checks 8 pixels for inequality
+ *
+ * @param a Pixels
+ * @param b Pixels
+ * @return Mask of different pixels
+ */
+inline __m128i differ(__m128i a, __m128i b) {
+	return _mm_xor_si128(_mm_cmpeq_epi16(a, b), _mm_set1_epi16(-1));
+}
+#endif
+
+namespace xbr {
+
+/**
+ * Pixels of 2xBR neighborhood (5x5 without corners, row by row)
+ */
+enum {
+	A1, B1, C1,              //!< Two lines above
+	A0, A, B, C, C4,         //!< Line above
+	D0, D, E, F, F4,         //!< Center line
+	G0, G, H, I, I4,         //!< Line below
+	G5, H5, I5,              //!< Two lines below
+	Count                    //!< Number of pixels
+};
+
+/**
+ * Roles of pixels in the reference filter for the bottom-right corner
+ */
+enum {
+	PE, PI, PH, PF, PG, PC, PD, PB, PF4, PI4, PH5, PI5
+};
+
+/**
+ * Offsets of pixels by line and column from the center
+ */
+constexpr int Offsets[Count][2] = {{-2, -1}, {-2, 0}, {-2, 1}, {-1, -2},
+    {-1, -1}, {-1, 0}, {-1, 1}, {-1, 2}, {0, -2}, {0, -1}, {0, 0}, {0, 1},
+    {0, 2}, {1, -2}, {1, -1}, {1, 0}, {1, 1}, {1, 2}, {2, -1}, {2, 0},
+    {2, 1}};
+
+/**
+ * Pixels taking the roles for every corner (neighborhood rotated)
+ */
+constexpr int Corners[4][12] = {{E, I, H, F, G, C, D, B, F4, I4, H5, I5},
+    {E, C, F, B, I, A, H, D, B1, C1, F4, C4},
+    {E, A, B, D, C, G, F, H, D0, A0, B1, A1},
+    {E, G, D, H, A, I, B, F, H5, G5, D0, G0}};
+
+/**
+ * Output pixels next to the corner along PF, along PH and in the corner
+ * (top-left, top-right, bottom-left, bottom-right)
+ */
+constexpr std::size_t Outputs[4][3] = {
+    {1, 2, 3}, {0, 3, 1}, {2, 1, 0}, {3, 0, 2}};
+
+}  // namespace xbr
+
+#ifdef VPNES_SSE2
+/**
+ * Loads 4 pixels
+ *
+ * @param src Pixels
+ * @return Loaded pixels
+ */
+inline __m128i load(const std::uint32_t *src) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+/**
+ * Converts 4 pixels to packed YUV
+ *
+ * @param pixels Pixels
+ * @param red Byte offset of red channel
+ * @return Y, U and V in bits 16-23, 8-15 and 0-7
+ */
+inline __m128i getYUV(__m128i pixels, std::size_t red) {
+	__m128i mask = _mm_set1_epi32(0xff);
+	__m128i r = _mm_and_si128(
+	    _mm_srl_epi32(pixels, _mm_cvtsi32_si128(int(red * 8))), mask);
+	__m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+	__m128i b = _mm_and_si128(
+	    _mm_srl_epi32(pixels, _mm_cvtsi32_si128(int(16 - red * 8))), mask);
+	// Channels take the low halves of lanes, so products are exact
+	auto dot = [r, g, b](int kr, int kg, int kb) {
+		return _mm_srai_epi32(
+		    _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(r, _mm_set1_epi32(kr)),
+		                      _mm_madd_epi16(g, _mm_set1_epi32(kg))),
+		        _mm_madd_epi16(b, _mm_set1_epi32(kb))),
+		    8);
+	};
+	__m128i y = dot(77, 150, 29);
+	__m128i u = _mm_add_epi32(dot(-43, -85, 128), _mm_set1_epi32(128));
+	__m128i v = _mm_add_epi32(dot(128, -107, -21), _mm_set1_epi32(128));
+	return _mm_or_si128(_mm_slli_epi32(y, 16),
+	    _mm_or_si128(_mm_slli_epi32(u, 8), v));
+}
+
+/**
+ * Gets absolute differences of YUV channels
+ *
+ * @param a Packed YUV
+ * @param b Packed YUV
+ * @return Differences in channel bytes
+ */
+inline __m128i getDifference(__m128i a, __m128i b) {
+	return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+/**
+ * Gets YUV distance for 4 pixels
+ *
+ * @param a Packed YUV
+ * @param b Packed YUV
+ * @return Sums of channel differences
+ */
+inline __m128i getDistance(__m128i a, __m128i b) {
+	__m128i diff = getDifference(a, b);
+	__m128i mask = _mm_set1_epi32(0xff);
+	return _mm_add_epi32(_mm_add_epi32(_mm_and_si128(diff, mask),
+	                         _mm_and_si128(_mm_srli_epi32(diff, 8), mask)),
+	    _mm_srli_epi32(diff, 16));
+}
+
+/**
+ * Checks if 4 colors are distinct by HQnx thresholds
+ *
+ * @param a Packed YUV
+ * @param b Packed YUV
+ * @return Mask of distinct colors
+ */
+inline __m128i isDistinct(__m128i a, __m128i b) {
+	// Thresholds are 48, 7 and 6 for Y, U and V
+	__m128i excess =
+	    _mm_subs_epu8(getDifference(a, b), _mm_set1_epi32(0x00300706));
+	return _mm_xor_si128(_mm_cmpeq_epi32(excess, _mm_setzero_si128()),
+	    _mm_set1_epi32(-1));
+}
+
+/**
+ * Blends four sets of 4 pixels with weights in eighths
+ *
+ * @param e First pixels
+ * @param a Second pixels
+ * @param b Third pixels
+ * @param c Fourth pixels
+ * @param weights Weights of the sets in bytes 0-3 (8 in sum)
+ * @return Blended pixels
+ */
+inline __m128i interpolate(
+    __m128i e, __m128i a, __m128i b, __m128i c, __m128i weights) {
+	const __m128i sources[4] = {e, a, b, c};
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = zero, high = zero;
+	for (int n = 0; n < 4; n++) {
+		__m128i weight =
+		    _mm_and_si128(_mm_srl_epi32(weights, _mm_cvtsi32_si128(n * 8)),
+		        _mm_set1_epi32(0xff));
+		// Every channel of a pixel gets its weight
+		weight = _mm_or_si128(weight, _mm_slli_epi32(weight, 16));
+		low = _mm_add_epi16(low,
+		    _mm_mullo_epi16(_mm_unpacklo_epi8(sources[n], zero),
+		        _mm_unpacklo_epi32(weight, weight)));
+		high = _mm_add_epi16(high,
+		    _mm_mullo_epi16(_mm_unpackhi_epi8(sources[n], zero),
+		        _mm_unpackhi_epi32(weight, weight)));
+	}
+	return _mm_packus_epi16(_mm_srli_epi16(low, 3), _mm_srli_epi16(high, 3));
+}
+
+/**
+ * Blends 4 pixels with weights in 256ths
+ *
+ * @param a Pixels
+ * @param b Pixels
+ * @param weights Weights of the second pixels (0-256)
+ * @return Blended pixels
+ */
+inline __m128i blend(__m128i a, __m128i b, __m128i weights) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i weightB = _mm_or_si128(weights, _mm_slli_epi32(weights, 16));
+	__m128i weightA = _mm_sub_epi16(_mm_set1_epi16(256), weightB);
+	// Sums reach 255 * 256 and are shifted as unsigned
+	__m128i low = _mm_add_epi16(
+	    _mm_mullo_epi16(
+	        _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi32(weightA, weightA)),
+	    _mm_mullo_epi16(
+	        _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi32(weightB, weightB)));
+	__m128i high = _mm_add_epi16(
+	    _mm_mullo_epi16(
+	        _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi32(weightA, weightA)),
+	    _mm_mullo_epi16(
+	        _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi32(weightB, weightB)));
+	return _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+}
+
+/**
+ * Computes a corner of HQ2x output for 4 pixels
+ *
+ * Edge masks select the weights of the blend, so all rules are computed
+ * without branches.
+ *
+ * @param e Center pixels
+ * @param a Vertical neighbors
+ * @param b Horizontal neighbors
+ * @param c Diagonal neighbors
+ * @param yuvE YUV of the centers
+ * @param yuvA YUV of the vertical neighbors
+ * @param yuvB YUV of the horizontal neighbors
+ * @param yuvC YUV of the diagonal neighbors
+ * @return Output pixels
+ */
+inline __m128i hq2xCorner(__m128i e, __m128i a, __m128i b, __m128i c,
+    __m128i yuvE, __m128i yuvA, __m128i yuvB, __m128i yuvC) {
+	__m128i edgeA = isDistinct(yuvE, yuvA);
+	__m128i edgeB = isDistinct(yuvE, yuvB);
+	__m128i edgeC = isDistinct(yuvE, yuvC);
+	__m128i edgeAB = isDistinct(yuvA, yuvB);
+	// Weights of E, A, B and C in eighths
+	auto weights = [](int we, int wa, int wb, int wc) {
+		return _mm_set1_epi32(we | (wa << 8) | (wb << 16) | (wc << 24));
+	};
+	// Rules are applied from the last to the first one
+	__m128i w = select(edgeC, weights(4, 2, 2, 0), weights(6, 1, 1, 0));
+	w = select(edgeAB,
+	    select(edgeC, weights(8, 0, 0, 0), weights(6, 0, 0, 2)), w);
+	w = select(edgeA, w,
+	    select(edgeC, weights(6, 2, 0, 0), weights(4, 2, 0, 2)));
+	w = select(edgeB, w,
+	    select(edgeC, weights(6, 0, 2, 0), weights(4, 0, 2, 2)));
+	w = select(_mm_or_si128(edgeA, edgeB), w, weights(4, 2, 2, 0));
+	return interpolate(e, a, b, c, w);
+}
+
+/**
+ * Blends a corner of 2xBR output for 4 pixels
+ *
+ * @param pixels Output pixels (top-left, top-right, bottom-left,
+ * bottom-right)
+ * @param p Neighborhood pixels
+ * @param yuv YUV of the neighborhood
+ */
+template <std::size_t Corner>
+inline void xbrCorner(__m128i *pixels, const __m128i *p, const __m128i *yuv) {
+	using namespace xbr;
+	const std::size_t n1 = Outputs[Corner][0], n2 = Outputs[Corner][1];
+	const std::size_t n3 = Outputs[Corner][2];
+	auto pixel = [p](int role) { return p[Corners[Corner][role]]; };
+	auto df = [yuv](int x, int y) {
+		return getDistance(yuv[Corners[Corner][x]], yuv[Corners[Corner][y]]);
+	};
+	auto eq = [&df](int x, int y) {
+		return _mm_cmplt_epi32(df(x, y), _mm_set1_epi32(155));
+	};
+	__m128i ones = _mm_set1_epi32(-1);
+	auto unequal = [&pixel, ones](int x, int y) {
+		return _mm_xor_si128(_mm_cmpeq_epi32(pixel(x), pixel(y)), ones);
+	};
+	__m128i active = _mm_and_si128(unequal(PE, PH), unequal(PE, PF));
+	__m128i e = _mm_add_epi32(
+	    _mm_add_epi32(_mm_add_epi32(df(PE, PC), df(PE, PG)),
+	        _mm_add_epi32(df(PI, PH5), df(PI, PF4))),
+	    _mm_slli_epi32(df(PH, PF), 2));
+	__m128i i = _mm_add_epi32(
+	    _mm_add_epi32(_mm_add_epi32(df(PH, PD), df(PH, PI5)),
+	        _mm_add_epi32(df(PF, PI4), df(PF, PB))),
+	    _mm_slli_epi32(df(PE, PI), 2));
+	__m128i smooth = _mm_or_si128(
+	    _mm_or_si128(
+	        _mm_andnot_si128(eq(PF, PB), _mm_andnot_si128(eq(PH, PD), ones)),
+	        _mm_andnot_si128(
+	            eq(PF, PI4), _mm_andnot_si128(eq(PH, PI5), eq(PE, PI)))),
+	    _mm_or_si128(eq(PE, PG), eq(PE, PC)));
+	__m128i edge =
+	    _mm_and_si128(active, _mm_and_si128(_mm_cmplt_epi32(e, i), smooth));
+	__m128i fallback =
+	    _mm_andnot_si128(_mm_cmpgt_epi32(e, i), _mm_andnot_si128(edge, active));
+	__m128i px = select(_mm_cmpgt_epi32(df(PE, PF), df(PE, PH)), pixel(PH),
+	    pixel(PF));
+	__m128i ke = df(PF, PG);
+	__m128i ki = df(PH, PC);
+	__m128i ex2 = _mm_and_si128(unequal(PE, PC), unequal(PB, PC));
+	__m128i ex3 = _mm_and_si128(unequal(PE, PG), unequal(PD, PG));
+	__m128i left = _mm_and_si128(edge,
+	    _mm_andnot_si128(_mm_cmpgt_epi32(_mm_slli_epi32(ke, 1), ki), ex3));
+	__m128i up = _mm_and_si128(edge,
+	    _mm_andnot_si128(_mm_cmplt_epi32(ke, _mm_slli_epi32(ki, 1)), ex2));
+	__m128i both = _mm_and_si128(left, up);
+	__m128i w3 =
+	    _mm_and_si128(_mm_or_si128(edge, fallback), _mm_set1_epi32(128));
+	w3 = select(_mm_or_si128(left, up), _mm_set1_epi32(192), w3);
+	w3 = select(both, _mm_set1_epi32(224), w3);
+	__m128i w2 = _mm_and_si128(left, _mm_set1_epi32(64));
+	__m128i w1 = _mm_and_si128(_mm_andnot_si128(left, up), _mm_set1_epi32(64));
+	__m128i corner = blend(pixels[n2], px, w2);
+	pixels[n1] = select(both, corner, blend(pixels[n1], px, w1));
+	pixels[n2] = corner;
+	pixels[n3] = blend(pixels[n3], px, w3);
+}
+#else
+/**
+ * Blends three pixels
+ *
+ * Channels are mixed in pairs, so the weights must not exceed 256 in sum.
+ *
+ * @param a First pixel
+ * @param wa Weight of the first pixel
+ * @param b Second pixel
+ * @param wb Weight of the second pixel
+ * @param c Third pixel
+ * @param wc Weight of the third pixel
+ * @param shift Log2 of the sum of weights
+ * @return Blended pixel
+ */
+inline std::uint32_t interpolate(std::uint32_t a, std::uint32_t wa,
+    std::uint32_t b, std::uint32_t wb, std::uint32_t c, std::uint32_t wc,
+    unsigned shift) {
+	std::uint32_t even = ((a & 0x00ff00ff) * wa + (b & 0x00ff00ff) * wb +
+	                         (c & 0x00ff00ff) * wc) >>
+	                     shift;
+	std::uint32_t odd = (((a >> 8) & 0x00ff00ff) * wa +
+	                        ((b >> 8) & 0x00ff00ff) * wb +
+	                        ((c >> 8) & 0x00ff00ff) * wc) >>
+	                    shift;
+	return (even & 0x00ff00ff) | ((odd & 0x00ff00ff) << 8);
+}
+
+/**
+ * Converts a pixel to packed YUV
+ *
+ * @param pixel Pixel
+ * @param red Byte offset of red channel
+ * @return Y, U and V in bits 16-23, 8-15 and 0-7
+ */
+inline std::uint32_t getYUV(std::uint32_t pixel, std::size_t red) {
+	std::uint8_t bytes[4];
+	std::memcpy(bytes, &pixel, sizeof(bytes));
+	int r = bytes[red], g = bytes[1], b = bytes[2 - red];
+	int y = (77 * r + 150 * g + 29 * b) >> 8;
+	int u = ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+	int v = ((128 * r - 107 * g - 21 * b) >> 8) + 128;
+	return (y << 16) | (u << 8) | v;
+}
+
+/**
+ * Gets YUV distance
+ *
+ * @param a Packed YUV
+ * @param b Packed YUV
+ * @return Sum of channel differences
+ */
+inline int getDistance(std::uint32_t a, std::uint32_t b) {
+	return std::abs(int(a >> 16) - int(b >> 16)) +
+	       std::abs(int((a >> 8) & 0xff) - int((b >> 8) & 0xff)) +
+	       std::abs(int(a & 0xff) - int(b & 0xff));
+}
+
+/**
+ * Checks if two colors are distinct by HQnx thresholds
+ *
+ * @param a Packed YUV
+ * @param b Packed YUV
+ * @return True if distinct
+ */
+inline bool isDistinct(std::uint32_t a, std::uint32_t b) {
+	return std::abs(int(a >> 16) - int(b >> 16)) > 48 ||
+	       std::abs(int((a >> 8) & 0xff) - int((b >> 8) & 0xff)) > 7 ||
+	       std::abs(int(a & 0xff) - int(b & 0xff)) > 6;
+}
+
+/**
+ * Computes a corner of HQ2x output
+ *
+ * Every output pixel uses the rules of the top-left one rotated to its
+ * corner. The extra blends hq2x has for shallow edges are not used.
+ *
+ * @param e Center pixel
+ * @param a Vertical neighbor
+ * @param b Horizontal neighbor
+ * @param c Diagonal neighbor
+ * @param yuvE YUV of the center
+ * @param yuvA YUV of the vertical neighbor
+ * @param yuvB YUV of the horizontal neighbor
+ * @param yuvC YUV of the diagonal neighbor
+ * @return Output pixel
+ */
+inline std::uint32_t hq2xCorner(std::uint32_t e, std::uint32_t a,
+    std::uint32_t b, std::uint32_t c, std::uint32_t yuvE, std::uint32_t yuvA,
+    std::uint32_t yuvB, std::uint32_t yuvC) {
+	bool edgeA = a != e && isDistinct(yuvE, yuvA);
+	bool edgeB = b != e && isDistinct(yuvE, yuvB);
+	bool edgeC = c != e && isDistinct(yuvE, yuvC);
+	if (!edgeA && !edgeB) {
+		return interpolate(e, 2, a, 1, b, 1, 2);
+	} else if (!edgeB) {
+		return edgeC ? interpolate(e, 3, b, 1, 0, 0, 2)
+		             : interpolate(e, 2, c, 1, b, 1, 2);
+	} else if (!edgeA) {
+		return edgeC ? interpolate(e, 3, a, 1, 0, 0, 2)
+		             : interpolate(e, 2, c, 1, a, 1, 2);
+	} else if (a != b && isDistinct(yuvA, yuvB)) {
+		return edgeC ? e : interpolate(e, 3, c, 1, 0, 0, 2);
+	}
+	// Both neighbors continue a diagonal edge through the corner
+	return edgeC ? interpolate(e, 2, a, 1, b, 1, 2)
+	             : interpolate(e, 6, a, 1, b, 1, 3);
+}
+
+/**
+ * Blends a corner of 2xBR output
+ *
+ * Pixel names follow the reference implementation with the corner between
+ * PH and PF. The neighborhood is rotated for every corner.
+ *
+ * @param pixels Output pixels (top-left, top-right, bottom-left,
+ * bottom-right)
+ * @param p Neighborhood pixels
+ * @param yuv YUV of the neighborhood
+ */
+template <std::size_t Corner>
+inline void xbrCorner(
+    std::uint32_t *pixels, const std::uint32_t *p, const std::uint32_t *yuv) {
+	using namespace xbr;
+	const std::size_t n1 = Outputs[Corner][0], n2 = Outputs[Corner][1];
+	const std::size_t n3 = Outputs[Corner][2];
+	auto pixel = [p](int role) { return p[Corners[Corner][role]]; };
+	auto df = [yuv](int x, int y) {
+		return getDistance(yuv[Corners[Corner][x]], yuv[Corners[Corner][y]]);
+	};
+	auto eq = [&df](int x, int y) { return df(x, y) < 155; };
+	if (pixel(PE) == pixel(PH) || pixel(PE) == pixel(PF)) {
+		return;
+	}
+	int e = df(PE, PC) + df(PE, PG) + df(PI, PH5) + df(PI, PF4) +
+	        (df(PH, PF) << 2);
+	int i = df(PH, PD) + df(PH, PI5) + df(PF, PI4) + df(PF, PB) +
+	        (df(PE, PI) << 2);
+	std::uint32_t px = (df(PE, PF) <= df(PE, PH)) ? pixel(PF) : pixel(PH);
+	if (e < i && ((!eq(PF, PB) && !eq(PH, PD)) ||
+	                 (eq(PE, PI) && !eq(PF, PI4) && !eq(PH, PI5)) ||
+	                 eq(PE, PG) || eq(PE, PC))) {
+		int ke = df(PF, PG);
+		int ki = df(PH, PC);
+		bool ex2 = pixel(PE) != pixel(PC) && pixel(PB) != pixel(PC);
+		bool ex3 = pixel(PE) != pixel(PG) && pixel(PD) != pixel(PG);
+		bool left = (ke << 1) <= ki && ex3;
+		bool up = ke >= (ki << 1) && ex2;
+		if (left && up) {
+			pixels[n3] = interpolate(pixels[n3], 32, px, 224, 0, 0, 8);
+			pixels[n2] = interpolate(pixels[n2], 192, px, 64, 0, 0, 8);
+			pixels[n1] = pixels[n2];
+		} else if (left) {
+			pixels[n3] = interpolate(pixels[n3], 64, px, 192, 0, 0, 8);
+			pixels[n2] = interpolate(pixels[n2], 192, px, 64, 0, 0, 8);
+		} else if (up) {
+			pixels[n3] = interpolate(pixels[n3], 64, px, 192, 0, 0, 8);
+			pixels[n1] = interpolate(pixels[n1], 192, px, 64, 0, 0, 8);
+		} else {
+			pixels[n3] = interpolate(pixels[n3], 128, px, 128, 0, 0, 8);
+		}
+	} else if (e <= i) {
+		pixels[n3] = interpolate(pixels[n3], 128, px, 128, 0, 0, 8);
+	}
+}
+#endif
+
+/* CScaler */
+
+/**
+ * Constructs the object
+ *
+ * @param name Scaler name
+ */
+CScaler::CScaler(const std::string &name) : m_Scaler(ScalerNearest) {
+	if (name == "scale2x") {
+		m_Scaler = ScalerScale2x;
+	} else if (name == "scale3x") {
+		m_Scaler = ScalerScale3x;
+	} else if (name == "hq2x") {
+		m_Scaler = ScalerHQ2x;
+	} else if (name == "xbr") {
+		m_Scaler = ScalerXBR;
+	} else if (name != "nearest") {
+		throw std::invalid_argument("Unknown scaler: " + name);
+	}
+}
+
+/**
+ * Scales a line by 2
+ *
+ * @param above Line above with border pixels
+ * @param line Line with border pixels
+ * @param below Line below with border pixels
+ * @param dst Output lines
+ */
+void CScaler::scale2x(const std::uint16_t *above, const std::uint16_t *line,
+    const std::uint16_t *below, std::uint16_t *dst) {
+	std::uint16_t *dst0 = dst;
+	std::uint16_t *dst1 = dst + core::frame::Width * 2;
+#ifdef VPNES_SSE2
+	for (std::size_t x = 1; x <= core::frame::Width; x += 8) {
+		__m128i b = load(above + x), h = load(below + x);
+		__m128i d = load(line + x - 1), e = load(line + x);
+		__m128i f = load(line + x + 1);
+		// Corners are filled only where B != H and D != F
+		__m128i edge = _mm_andnot_si128(
+		    _mm_or_si128(_mm_cmpeq_epi16(b, h), _mm_cmpeq_epi16(d, f)),
+		    _mm_set1_epi16(-1));
+		__m128i e0 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(d, b)), d, e);
+		__m128i e1 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(b, f)), f, e);
+		__m128i e2 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(d, h)), d, e);
+		__m128i e3 = select(_mm_and_si128(edge, _mm_cmpeq_epi16(h, f)), f, e);
+		__m128i *out0 = reinterpret_cast<__m128i *>(dst0 + (x - 1) * 2);
+		__m128i *out1 = reinterpret_cast<__m128i *>(dst1 + (x - 1) * 2);
+		_mm_storeu_si128(out0, _mm_unpacklo_epi16(e0, e1));
+		_mm_storeu_si128(out0 + 1, _mm_unpackhi_epi16(e0, e1));
+		_mm_storeu_si128(out1, _mm_unpacklo_epi16(e2, e3));
+		_mm_storeu_si128(out1 + 1, _mm_unpackhi_epi16(e2, e3));
+	}
+#else
+	for (std::size_t x = 1; x <= core::frame::Width; x++) {
+		std::uint16_t b = above[x], h = below[x];
+		std::uint16_t d = line[x - 1], e = line[x], f = line[x + 1];
+		bool edge = b != h && d != f;
+		dst0[x * 2 - 2] = (edge && d == b) ? d : e;
+		dst0[x * 2 - 1] = (edge && b == f) ? f : e;
+		dst1[x * 2 - 2] = (edge && d == h) ? d : e;
+		dst1[x * 2 - 1] = (edge && h == f) ? f : e;
+	}
+#endif
+}
+
+/**
+ * Scales a line by 3
+ *
+ * @param above Line above with border pixels
+ * @param line Line with border pixels
+ * @param below Line below with border pixels
+ * @param dst Output lines
+ */
+void CScaler::scale3x(const std::uint16_t *above, const std::uint16_t *line,
+    const std::uint16_t *below, std::uint16_t *dst) {
+	std::uint16_t *out[3] = {dst, dst + core::frame::Width * 3,
+	    dst + core::frame::Width * 6};
+#ifdef VPNES_SSE2
+	for (std::size_t x = 1; x <= core::frame::Width; x += 8) {
+		__m128i a = load(above + x - 1), b = load(above + x);
+		__m128i c = load(above + x + 1), d = load(line + x - 1);
+		__m128i e = load(line + x), f = load(line + x + 1);
+		__m128i g = load(below + x - 1), h = load(below + x);
+		__m128i i = load(below + x + 1);
+		__m128i edge = _mm_andnot_si128(
+		    _mm_or_si128(_mm_cmpeq_epi16(b, h), _mm_cmpeq_epi16(d, f)),
+		    _mm_set1_epi16(-1));
+		__m128i db = _mm_and_si128(edge, _mm_cmpeq_epi16(d, b));
+		__m128i bf = _mm_and_si128(edge, _mm_cmpeq_epi16(b, f));
+		__m128i dh = _mm_and_si128(edge, _mm_cmpeq_epi16(d, h));
+		__m128i hf = _mm_and_si128(edge, _mm_cmpeq_epi16(h, f));
+		__m128i pixels[9] = {select(db, d, e),
+		    select(_mm_or_si128(_mm_and_si128(db, differ(e, c)),
+		               _mm_and_si128(bf, differ(e, a))),
+		        b, e),
+		    select(bf, f, e),
+		    select(_mm_or_si128(_mm_and_si128(db, differ(e, g)),
+		               _mm_and_si128(dh, differ(e, a))),
+		        d, e),
+		    e,
+		    select(_mm_or_si128(_mm_and_si128(bf, differ(e, i)),
+		               _mm_and_si128(hf, differ(e, c))),
+		        f, e),
+		    select(dh, d, e),
+		    select(_mm_or_si128(_mm_and_si128(dh, differ(e, i)),
+		               _mm_and_si128(hf, differ(e, g))),
+		        h, e),
+		    select(hf, f, e)};
+		// Three-way interleaving has no instruction, so spread by hand
+		std::uint16_t spread[9][8];
+		for (std::size_t n = 0; n < 9; n++) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(spread[n]), pixels[n]);
+		}
+		for (std::size_t n = 0; n < 8; n++) {
+			for (std::size_t row = 0; row < 3; row++) {
+				std::uint16_t *pixel = out[row] + (x - 1 + n) * 3;
+				pixel[0] = spread[row * 3][n];
+				pixel[1] = spread[row * 3 + 1][n];
+				pixel[2] = spread[row * 3 + 2][n];
+			}
+		}
+	}
+#else
+	for (std::size_t x = 1; x <= core::frame::Width; x++) {
+		std::uint16_t a = above[x - 1], b = above[x], c = above[x + 1];
+		std::uint16_t d = line[x - 1], e = line[x], f = line[x + 1];
+		std::uint16_t g = below[x - 1], h = below[x], i = below[x + 1];
+		bool edge = b != h && d != f;
+		bool db = edge && d == b, bf = edge && b == f;
+		bool dh = edge && d == h, hf = edge && h == f;
+		std::uint16_t *pixel[3] = {out[0] + (x - 1) * 3,
+		    out[1] + (x - 1) * 3, out[2] + (x - 1) * 3};
+		pixel[0][0] = db ? d : e;
+		pixel[0][1] = ((db && e != c) || (bf && e != a)) ? b : e;
+		pixel[0][2] = bf ? f : e;
+		pixel[1][0] = ((db && e != g) || (dh && e != a)) ? d : e;
+		pixel[1][1] = e;
+		pixel[1][2] = ((bf && e != i) || (hf && e != c)) ? f : e;
+		pixel[2][0] = dh ? d : e;
+		pixel[2][1] = ((dh && e != i) || (hf && e != g)) ? h : e;
+		pixel[2][2] = hf ? f : e;
+	}
+#endif
+}
+
+/**
+ * Scales a line by 2 with reduced HQ2x corner rules
+ *
+ * @param lines Lines from 2 above to 2 below with border pixels
+ * @param yuv YUV values of the lines
+ * @param dst0 Upper output line
+ * @param dst1 Lower output line
+ */
+void CScaler::hq2x(const std::uint32_t *const *lines,
+    const std::uint32_t *const *yuv, std::uint32_t *dst0,
+    std::uint32_t *dst1) {
+	const std::uint32_t *above = lines[1], *line = lines[2];
+	const std::uint32_t *below = lines[3];
+	const std::uint32_t *yuvAbove = yuv[1], *yuvLine = yuv[2];
+	const std::uint32_t *yuvBelow = yuv[3];
+#ifdef VPNES_SSE2
+	for (std::size_t x = 2; x < core::frame::Width + 2; x += 4) {
+		__m128i a = load(above + x - 1), b = load(above + x);
+		__m128i c = load(above + x + 1), d = load(line + x - 1);
+		__m128i e = load(line + x), f = load(line + x + 1);
+		__m128i g = load(below + x - 1), h = load(below + x);
+		__m128i i = load(below + x + 1);
+		__m128i yuvA = load(yuvAbove + x - 1), yuvB = load(yuvAbove + x);
+		__m128i yuvC = load(yuvAbove + x + 1), yuvD = load(yuvLine + x - 1);
+		__m128i yuvE = load(yuvLine + x), yuvF = load(yuvLine + x + 1);
+		__m128i yuvG = load(yuvBelow + x - 1), yuvH = load(yuvBelow + x);
+		__m128i yuvI = load(yuvBelow + x + 1);
+		__m128i e0 = hq2xCorner(e, b, d, a, yuvE, yuvB, yuvD, yuvA);
+		__m128i e1 = hq2xCorner(e, b, f, c, yuvE, yuvB, yuvF, yuvC);
+		__m128i e2 = hq2xCorner(e, h, d, g, yuvE, yuvH, yuvD, yuvG);
+		__m128i e3 = hq2xCorner(e, h, f, i, yuvE, yuvH, yuvF, yuvI);
+		__m128i *out0 = reinterpret_cast<__m128i *>(dst0 + (x - 2) * 2);
+		__m128i *out1 = reinterpret_cast<__m128i *>(dst1 + (x - 2) * 2);
+		_mm_storeu_si128(out0, _mm_unpacklo_epi32(e0, e1));
+		_mm_storeu_si128(out0 + 1, _mm_unpackhi_epi32(e0, e1));
+		_mm_storeu_si128(out1, _mm_unpacklo_epi32(e2, e3));
+		_mm_storeu_si128(out1 + 1, _mm_unpackhi_epi32(e2, e3));
+	}
+#else
+	for (std::size_t x = 2; x < core::frame::Width + 2; x++) {
+		std::uint32_t e = line[x], yuvE = yuvLine[x];
+		std::uint32_t *out0 = dst0 + (x - 2) * 2;
+		std::uint32_t *out1 = dst1 + (x - 2) * 2;
+		out0[0] = hq2xCorner(e, above[x], line[x - 1], above[x - 1], yuvE,
+		    yuvAbove[x], yuvLine[x - 1], yuvAbove[x - 1]);
+		out0[1] = hq2xCorner(e, above[x], line[x + 1], above[x + 1], yuvE,
+		    yuvAbove[x], yuvLine[x + 1], yuvAbove[x + 1]);
+		out1[0] = hq2xCorner(e, below[x], line[x - 1], below[x - 1], yuvE,
+		    yuvBelow[x], yuvLine[x - 1], yuvBelow[x - 1]);
+		out1[1] = hq2xCorner(e, below[x], line[x + 1], below[x + 1], yuvE,
+		    yuvBelow[x], yuvLine[x + 1], yuvBelow[x + 1]);
+	}
+#endif
+}
+
+/**
+ * Scales a line by 2 with 2xBR
+ *
+ * @param lines Lines from 2 above to 2 below with border pixels
+ * @param yuv YUV values of the lines
+ * @param dst0 Upper output line
+ * @param dst1 Lower output line
+ */
+void CScaler::xbr(const std::uint32_t *const *lines,
+    const std::uint32_t *const *yuv, std::uint32_t *dst0,
+    std::uint32_t *dst1) {
+	using xbr::Offsets;
+#ifdef VPNES_SSE2
+	for (std::size_t x = 2; x < core::frame::Width + 2; x += 4) {
+		__m128i p[xbr::Count], q[xbr::Count];
+		for (int n = 0; n < xbr::Count; n++) {
+			std::size_t line = 2 + Offsets[n][0], column = x + Offsets[n][1];
+			p[n] = load(lines[line] + column);
+			q[n] = load(yuv[line] + column);
+		}
+		__m128i pixels[4] = {p[xbr::E], p[xbr::E], p[xbr::E], p[xbr::E]};
+		xbrCorner<0>(pixels, p, q);
+		xbrCorner<1>(pixels, p, q);
+		xbrCorner<2>(pixels, p, q);
+		xbrCorner<3>(pixels, p, q);
+		__m128i *out0 = reinterpret_cast<__m128i *>(dst0 + (x - 2) * 2);
+		__m128i *out1 = reinterpret_cast<__m128i *>(dst1 + (x - 2) * 2);
+		_mm_storeu_si128(out0, _mm_unpacklo_epi32(pixels[0], pixels[1]));
+		_mm_storeu_si128(out0 + 1, _mm_unpackhi_epi32(pixels[0], pixels[1]));
+		_mm_storeu_si128(out1, _mm_unpacklo_epi32(pixels[2], pixels[3]));
+		_mm_storeu_si128(out1 + 1, _mm_unpackhi_epi32(pixels[2], pixels[3]));
+	}
+#else
+	for (std::size_t x = 2; x < core::frame::Width + 2; x++) {
+		std::uint32_t p[xbr::Count], q[xbr::Count];
+		for (int n = 0; n < xbr::Count; n++) {
+			std::size_t line = 2 + Offsets[n][0], column = x + Offsets[n][1];
+			p[n] = lines[line][column];
+			q[n] = yuv[line][column];
+		}
+		std::uint32_t pixels[4] = {p[xbr::E], p[xbr::E], p[xbr::E], p[xbr::E]};
+		xbrCorner<0>(pixels, p, q);
+		xbrCorner<1>(pixels, p, q);
+		xbrCorner<2>(pixels, p, q);
+		xbrCorner<3>(pixels, p, q);
+		std::uint32_t *out0 = dst0 + (x - 2) * 2;
+		std::uint32_t *out1 = dst1 + (x - 2) * 2;
+		out0[0] = pixels[0];
+		out0[1] = pixels[1];
+		out1[0] = pixels[2];
+		out1[1] = pixels[3];
+	}
+#endif
+}
+
+/**
+ * Scales frame
+ *
+ * @param frameBuffer Frame (core::frame::Width * core::frame::Height)
+ * @param scaled Output frame (getWidth() * getHeight())
+ */
+void CScaler::scale(
+    const std::uint16_t *frameBuffer, std::uint16_t *scaled) const {
+	if (m_Scaler == ScalerNearest) {
+		std::memcpy(scaled, frameBuffer,
+		    core::frame::Width * core::frame::Height * sizeof(std::uint16_t));
+		return;
+	}
+	// Lines with edge pixels repeated on both sides
+	std::uint16_t lines[3][core::frame::Width + 2];
+	auto loadLine = [frameBuffer](std::size_t y, std::uint16_t *line) {
+		const std::uint16_t *src = frameBuffer + y * core::frame::Width;
+		std::memcpy(line + 1, src, core::frame::Width * sizeof(std::uint16_t));
+		line[0] = src[0];
+		line[core::frame::Width + 1] = src[core::frame::Width - 1];
+	};
+	loadLine(0, lines[0]);
+	loadLine(0, lines[1]);
+	std::size_t factor = getFactor();
+	for (std::size_t y = 0; y < core::frame::Height; y++) {
+		std::uint16_t *above = lines[y % 3];
+		std::uint16_t *line = lines[(y + 1) % 3];
+		std::uint16_t *below = lines[(y + 2) % 3];
+		loadLine((y + 1 < core::frame::Height) ? y + 1 : y, below);
+		std::uint16_t *dst = scaled + y * factor * factor * core::frame::Width;
+		if (m_Scaler == ScalerScale2x) {
+			scale2x(above, line, below, dst);
+		} else {
+			scale3x(above, line, below, dst);
+		}
+	}
+}
+
+/**
+ * Scales converted frame
+ *
+ * @param frameBuffer 32-bit frame (core::frame::Width *
+ * core::frame::Height)
+ * @param pixels Output pixels (getWidth() * getHeight())
+ * @param pitch Output line size in bytes
+ * @param format Pixel format of the frame
+ */
+void CScaler::scale(const std::uint32_t *frameBuffer, void *pixels,
+    std::size_t pitch, CFrameConverter::EPixelFormat format) const {
+	enum {
+		Border = 2,                                 //!< Border pixels
+		LineSize = core::frame::Width + Border * 2  //!< Line with borders
+	};
+	std::size_t red = (format == CFrameConverter::PixelFormatBGRA32) ? 2 : 0;
+	// Window of 5 lines with edge pixels repeated on both sides
+	std::uint32_t lines[5][LineSize];
+	std::uint32_t yuv[5][LineSize];
+	auto loadLine = [frameBuffer, red, &lines, &yuv](int y) {
+		std::size_t slot = (y + Border) % 5;
+		y = std::max(0, std::min(y, int(core::frame::Height) - 1));
+		const std::uint32_t *src = frameBuffer + y * core::frame::Width;
+		for (std::size_t x = 0; x < LineSize; x++) {
+			std::size_t column = std::min<std::size_t>(
+			    x < Border ? 0 : x - Border, core::frame::Width - 1);
+			lines[slot][x] = src[column];
+		}
+#ifdef VPNES_SSE2
+		for (std::size_t x = 0; x < LineSize; x += 4) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(yuv[slot] + x),
+			    getYUV(load(lines[slot] + x), red));
+		}
+#else
+		for (std::size_t x = 0; x < LineSize; x++) {
+			yuv[slot][x] = getYUV(lines[slot][x], red);
+		}
+#endif
+	};
+	for (int y = -Border; y < Border; y++) {
+		loadLine(y);
+	}
+	std::uint8_t *dst = static_cast<std::uint8_t *>(pixels);
+	for (std::size_t y = 0; y < core::frame::Height; y++) {
+		loadLine(y + Border);
+		const std::uint32_t *window[5], *windowYUV[5];
+		for (std::size_t n = 0; n < 5; n++) {
+			window[n] = lines[(y + n) % 5];
+			windowYUV[n] = yuv[(y + n) % 5];
+		}
+		std::uint32_t *dst0 = reinterpret_cast<std::uint32_t *>(dst);
+		std::uint32_t *dst1 = reinterpret_cast<std::uint32_t *>(dst + pitch);
+		if (m_Scaler == ScalerHQ2x) {
+			hq2x(window, windowYUV, dst0, dst1);
+		} else {
+			xbr(window, windowYUV, dst0, dst1);
+		}
+		dst += pitch * 2;
+	}
+}
+
+}  // namespace gui
+
+}  // namespace vpnes
@@ -0,0 +1,185 @@
+/**
+ * @file
+ *
+ * Implements frame conversion to host pixel formats
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/video.hpp>
+#include <vpnes/core/frontend.hpp>
+
+#ifdef VPNES_AVX2
+#include <immintrin.h>
+#endif
+
+namespace vpnes {
+
+namespace gui {
+
+/**
+ * RGB values of NES colors
+ */
+const std::uint8_t nesPalette[0x40][3] = {
+    {84, 84, 84}, {0, 30, 116}, {8, 16, 144}, {48, 0, 136}, {68, 0, 100},
+    {92, 0, 48}, {84, 4, 0}, {60, 24, 0}, {32, 42, 0}, {8, 58, 0},
+    {0, 64, 0}, {0, 60, 0}, {0, 50, 60}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+    {152, 150, 152}, {8, 76, 196}, {48, 50, 236}, {92, 30, 228},
+    {136, 20, 176}, {160, 20, 100}, {152, 34, 32}, {120, 60, 0},
+    {84, 90, 0}, {40, 114, 0}, {8, 124, 0}, {0, 118, 40}, {0, 102, 120},
+    {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {236, 238, 236}, {76, 154, 236},
+    {120, 124, 236}, {176, 98, 236}, {228, 84, 236}, {236, 88, 180},
+    {236, 106, 100}, {212, 136, 32}, {160, 170, 0}, {116, 196, 0},
+    {76, 208, 32}, {56, 204, 108}, {56, 180, 204}, {60, 60, 60}, {0, 0, 0},
+    {0, 0, 0}, {236, 238, 236}, {168, 204, 236}, {188, 188, 236},
+    {212, 178, 236}, {236, 174, 236}, {236, 174, 212}, {236, 180, 176},
+    {228, 196, 144}, {204, 210, 120}, {180, 222, 120}, {168, 226, 144},
+    {152, 226, 180}, {160, 214, 228}, {160, 162, 160}, {0, 0, 0},
+    {0, 0, 0}};
+
+/* CFrameConverter */
+
+/**
+ * Constructs the object
+ *
+ * @param format Pixel format
+ */
+CFrameConverter::CFrameConverter(EPixelFormat format)
+    : m_Format(format), m_Colors() {
+	for (std::size_t pixel = 0; pixel < core::frame::Colors; pixel++) {
+		std::size_t color = pixel & core::frame::ColorMask;
+		std::size_t emphasis = pixel >> core::frame::EmphasisShift;
+		std::uint8_t rgb[3];
+		for (std::size_t channel = 0; channel < 3; channel++) {
+			rgb[channel] = nesPalette[color][channel];
+			// Each emphasis bit darkens the other two channels
+			if ((emphasis & ~(1 << channel)) && (color & 0x0e) != 0x0e) {
+				rgb[channel] = rgb[channel] * 209 / 256;
+			}
+		}
+		switch (m_Format) {
+		case PixelFormatRGBA32: {
+			std::uint8_t bytes[4] = {rgb[0], rgb[1], rgb[2], 0xff};
+			std::memcpy(&m_Colors[pixel], bytes, sizeof(bytes));
+			break;
+		}
+		case PixelFormatBGRA32: {
+			std::uint8_t bytes[4] = {rgb[2], rgb[1], rgb[0], 0xff};
+			std::memcpy(&m_Colors[pixel], bytes, sizeof(bytes));
+			break;
+		}
+		case PixelFormatRGB565:
+			m_Colors[pixel] =
+			    ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+			break;
+		}
+	}
+}
+
+/**
+ * Converts a line to 32-bit pixels
+ *
+ * @param src Source line
+ * @param dst Output line
+ * @param width Line width (multiple of 16)
+ */
+void CFrameConverter::convertLine32(const std::uint16_t *src,
+    std::uint32_t *dst, std::size_t width) const {
+#ifdef VPNES_AVX2
+	const int *colors = reinterpret_cast<const int *>(m_Colors);
+	for (std::size_t x = 0; x < width; x += 8) {
+		__m256i index = _mm256_cvtepu16_epi32(
+		    _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x),
+		    _mm256_i32gather_epi32(colors, index, 4));
+	}
+#else
+	for (std::size_t x = 0; x < width; x++) {
+		dst[x] = m_Colors[src[x]];
+	}
+#endif
+}
+
+/**
+ * Converts a line to 16-bit pixels
+ *
+ * @param src Source line
+ * @param dst Output line
+ * @param width Line width (multiple of 16)
+ */
+void CFrameConverter::convertLine16(const std::uint16_t *src,
+    std::uint16_t *dst, std::size_t width) const {
+#ifdef VPNES_AVX2
+	const int *colors = reinterpret_cast<const int *>(m_Colors);
+	for (std::size_t x = 0; x < width; x += 16) {
+		__m256i index = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i *>(src + x));
+		__m256i low = _mm256_i32gather_epi32(colors,
+		    _mm256_cvtepu16_epi32(_mm256_castsi256_si128(index)), 4);
+		__m256i high = _mm256_i32gather_epi32(colors,
+		    _mm256_cvtepu16_epi32(_mm256_extracti128_si256(index, 1)), 4);
+		// Packing works within lanes, so restore the order afterwards
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x),
+		    _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xd8));
+	}
+#else
+	for (std::size_t x = 0; x < width; x++) {
+		dst[x] = static_cast<std::uint16_t>(m_Colors[src[x]]);
+	}
+#endif
+}
+
+/**
+ * Converts frame of any size
+ *
+ * @param frameBuffer Frame
+ * @param width Frame width (multiple of 16)
+ * @param height Frame height
+ * @param pixels Output pixels
+ * @param pitch Output line size in bytes
+ */
+void CFrameConverter::convert(const std::uint16_t *frameBuffer,
+    std::size_t width, std::size_t height, void *pixels,
+    std::size_t pitch) const {
+	std::uint8_t *line = static_cast<std::uint8_t *>(pixels);
+	for (std::size_t y = 0; y < height; y++) {
+		if (m_Format == PixelFormatRGB565) {
+			convertLine16(
+			    frameBuffer, reinterpret_cast<std::uint16_t *>(line), width);
+		} else {
+			convertLine32(
+			    frameBuffer, reinterpret_cast<std::uint32_t *>(line), width);
+		}
+		frameBuffer += width;
+		line += pitch;
+	}
+}
+
+}  // namespace gui
+
+}  // namespace vpnes
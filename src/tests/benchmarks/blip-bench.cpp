@@ -0,0 +1,103 @@
+/**
+ * @file
+ * Band-limited step buffer benchmark
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/blip.hpp>
+
+using namespace vpnes::core;
+
+/**
+ * Benchmark parameters
+ */
+enum {
+	BlockTime = 357368,  //!< NTSC frame in ticks
+	SampleRate = 48000,  //!< Output sample rate
+	Blocks = 20000       //!< Number of measured blocks
+};
+
+/**
+ * Steps of one block
+ */
+typedef std::vector<std::pair<ticks_t, int>> steps_t;
+
+/**
+ * Gets steps of four busy square channels
+ *
+ * @return Steps sorted by time
+ */
+steps_t getSteps() {
+	static const ticks_t periods[] = {
+	    12 * 2 * 254, 12 * 2 * 190, 12 * 2 * 380, 12 * 64};
+	static const int amplitudes[] = {2000, 1500, 2500, 900};
+	steps_t steps;
+	for (std::size_t channel = 0; channel < 4; channel++) {
+		int sign = 1;
+		for (ticks_t time = channel * 77; time < BlockTime;
+		     time += periods[channel] / 2) {
+			steps.emplace_back(time, sign * amplitudes[channel]);
+			sign = -sign;
+		}
+	}
+	std::sort(steps.begin(), steps.end());
+	return steps;
+}
+
+/**
+ * Measures a mixer
+ *
+ * @param name Mixer name
+ * @param steps Steps of one block
+ */
+template <CBlipBuffer::EMixer Mixer>
+void measure(const char *name, const steps_t &steps) {
+	CBlipBuffer blip(44 / 945000.0, BlockTime);
+	blip.setSampleRate(SampleRate);
+	std::uint32_t hash = 0;
+	std::size_t total = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int block = 0; block < Blocks; block++) {
+		for (const auto &step : steps) {
+			blip.addDelta<Mixer>(step.first, step.second);
+		}
+		std::size_t count = blip.endBlock(BlockTime);
+		const std::int16_t *samples = blip.getSamples();
+		for (std::size_t i = 0; i < count; i++) {
+			hash = hash * 31 + static_cast<std::uint16_t>(samples[i]);
+		}
+		total += count;
+	}
+	double seconds = std::chrono::duration<double>(
+	    std::chrono::steady_clock::now() - start)
+	                     .count();
+	// Equal hashes show that the mixers give the same output
+	std::cout << name << ": " << total / seconds / 1e6 << " M samples/s, "
+	          << steps.size() * Blocks / seconds / 1e6 << " M steps/s, hash "
+	          << std::hex << hash << std::dec << std::endl;
+}
+
+/**
+ * Main function
+ *
+ * @return Exit code
+ */
+int main() {
+	steps_t steps = getSteps();
+	std::cout << steps.size() << " steps per block" << std::endl;
+	measure<CBlipBuffer::MixerScalar>("scalar", steps);
+#ifdef VPNES_SSE2
+	measure<CBlipBuffer::MixerSSE2>("SSE2", steps);
+#endif
+#ifdef VPNES_AVX2
+	measure<CBlipBuffer::MixerAVX2>("AVX2", steps);
+#endif
+	return EXIT_SUCCESS;
+}
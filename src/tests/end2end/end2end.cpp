@@ -33,7 +33,6 @@
 #include <string>
 #include <iostream>
 #include <sstream>
-#include <fstream>
 #include <vpnes/vpnes.hpp>
 #include <vpnes/gui/config.hpp>
 #include <vpnes/core/frontend.hpp>
@@ -118,6 +117,14 @@ public:
 	 * Destructor
 	 */
 	~CTestFrontEnd() = default;
+	/**
+	 * Gets buffer for the next frame
+	 *
+	 * @return Null buffer, pixels are not needed
+	 */
+	std::uint16_t *getFrameBuffer() {
+		return nullptr;
+	}
 	/**
 	 * Frame-ready callback
 	 *
@@ -165,10 +172,8 @@ int main(int argc, char **argv) {
 		if (!config.hasTimeout()) {
 			throw std::invalid_argument("No timeout specified");
 		}
-		std::ifstream inputFile = config.getInputFile();
 		vpnes::core::SNESConfig nesConfig;
-		nesConfig.configure(config, &inputFile);
-		inputFile.close();
+		nesConfig.configure(config);
 		int result = EXIT_FAILURE;
 		bool inProgress = false;
 		auto time = std::chrono::seconds(config.getTimeout());
@@ -0,0 +1,146 @@
+/**
+ * @file
+ * Tests lazy advance of APU channels
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/apu_channels.hpp>
+
+using namespace vpnes::core::apu;
+
+/**
+ * Gets lengths of skipped spans
+ *
+ * @param seed Generator state
+ * @return Number of cycles (1-1000)
+ */
+inline int getSpan(std::uint32_t &seed) {
+	seed = seed * 1664525 + 1013904223;
+	return (seed >> 16) % 1000 + 1;
+}
+
+/**
+ * Advances channels per cycle and lazily and compares them
+ *
+ * Frame counter clocks are applied to both channels between spans, as the
+ * APU does.
+ *
+ * @param stepped Channel advanced per cycle
+ * @param skipped Channel advanced in closed form
+ * @param spans Number of spans
+ */
+template <class Channel>
+void compareAdvance(Channel &stepped, Channel &skipped, int spans) {
+	std::uint32_t seed = 1;
+	for (int span = 0; span < spans; span++) {
+		int cycles = getSpan(seed);
+		for (int cycle = 0; cycle < cycles; cycle++) {
+			stepped.tick();
+		}
+		skipped.skip(cycles);
+		BOOST_REQUIRE_EQUAL(stepped.getDistance(), skipped.getDistance());
+		BOOST_REQUIRE_EQUAL(stepped.getOutput(), skipped.getOutput());
+		if (span % 4 == 0) {
+			stepped.clockQuarter();
+			skipped.clockQuarter();
+		}
+		if (span % 8 == 0) {
+			stepped.clockHalf();
+			skipped.clockHalf();
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(pulse_skip) {
+	CPulse stepped(true), skipped(true);
+	for (CPulse *pulse : {&stepped, &skipped}) {
+		pulse->getLength().setEnabled(true);
+		pulse->write(0x9f, 0);  // 50% duty, constant volume 15
+		pulse->write(0x00, 1);
+		pulse->write(0x53, 2);
+		pulse->write(0x01, 3);
+	}
+	compareAdvance(stepped, skipped, 500);
+}
+
+BOOST_AUTO_TEST_CASE(triangle_skip) {
+	CTriangle stepped, skipped;
+	for (CTriangle *triangle : {&stepped, &skipped}) {
+		triangle->getLength().setEnabled(true);
+		triangle->write(0xff, 0);  // Linear counter halted
+		triangle->write(0x2b, 2);
+		triangle->write(0x00, 3);
+		triangle->clockQuarter();
+	}
+	compareAdvance(stepped, skipped, 500);
+}
+
+BOOST_AUTO_TEST_CASE(noise_skip) {
+	for (std::uint8_t mode : {0x03, 0x83}) {
+		CNoise stepped, skipped;
+		for (CNoise *noise : {&stepped, &skipped}) {
+			noise->getLength().setEnabled(true);
+			noise->write(0x3f, 0);  // Constant volume 15, length halted
+			noise->write(mode, 2);
+			noise->write(0x00, 3);
+		}
+		compareAdvance(stepped, skipped, 500);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(dmc_skip) {
+	CDMC stepped, skipped;
+	std::uint32_t seed = 1;
+	for (CDMC *dmc : {&stepped, &skipped}) {
+		dmc->write(0x0d, 0);
+		dmc->write(0x40, 1);
+		dmc->write(0x00, 3);  // One byte
+	}
+	for (int span = 0; span < 100; span++) {
+		// Idle channel is skipped
+		int cycles = getSpan(seed);
+		for (int cycle = 0; cycle < cycles; cycle++) {
+			stepped.tick();
+		}
+		skipped.skip(cycles);
+		BOOST_REQUIRE_EQUAL(stepped.getDistance(), skipped.getDistance());
+		BOOST_REQUIRE_EQUAL(stepped.getOutput(), skipped.getOutput());
+		// The bit counter decides when the fetched byte starts playing
+		for (CDMC *dmc : {&stepped, &skipped}) {
+			dmc->setEnabled(true);
+			dmc->load(static_cast<std::uint8_t>(seed));
+		}
+		BOOST_REQUIRE_EQUAL(
+		    stepped.getFetchDistance(), skipped.getFetchDistance());
+		while (!stepped.isIdle() || !skipped.isIdle()) {
+			stepped.tick();
+			skipped.tick();
+			BOOST_REQUIRE_EQUAL(stepped.getOutput(), skipped.getOutput());
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * Tests band-limited step buffer
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/apu_channels.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/blip.hpp>
+
+using namespace vpnes::core;
+
+/**
+ * Adds the same steps with a mixer and compares its output to scalar one
+ *
+ * Deltas swing between the ends of 16-bit range, where SSE2 products need
+ * both halves.
+ *
+ * @param blocks Number of blocks
+ */
+template <CBlipBuffer::EMixer Mixer>
+void compareMixer(int blocks) {
+	const ticks_t blockTime = 357368;
+	CBlipBuffer scalar(44 / 945000.0, blockTime);
+	CBlipBuffer vector(44 / 945000.0, blockTime);
+	scalar.setSampleRate(48000);
+	vector.setSampleRate(48000);
+	static const int deltas[] = {32767, -32768, -32767, 32766, 1, -1};
+	std::uint32_t seed = 1;
+	for (int block = 0; block < blocks; block++) {
+		ticks_t time = 0;
+		for (std::size_t step = 0; time < blockTime; step++) {
+			int delta = deltas[step % (sizeof(deltas) / sizeof(deltas[0]))];
+			scalar.addDelta<CBlipBuffer::MixerScalar>(time, delta);
+			vector.addDelta<Mixer>(time, delta);
+			seed = seed * 1664525 + 1013904223;
+			time += (seed >> 16) % 2000;
+		}
+		std::size_t count = scalar.endBlock(blockTime);
+		BOOST_REQUIRE_EQUAL(count, vector.endBlock(blockTime));
+		const std::int16_t *expected = scalar.getSamples();
+		const std::int16_t *samples = vector.getSamples();
+		for (std::size_t i = 0; i < count; i++) {
+			BOOST_REQUIRE_EQUAL(expected[i], samples[i]);
+		}
+	}
+}
+
+#ifdef VPNES_SSE2
+BOOST_AUTO_TEST_CASE(blip_sse2) {
+	compareMixer<CBlipBuffer::MixerSSE2>(100);
+}
+#endif
+
+#ifdef VPNES_AVX2
+BOOST_AUTO_TEST_CASE(blip_avx2) {
+	compareMixer<CBlipBuffer::MixerAVX2>(100);
+}
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * Tests lock-free buffers
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/apu_channels.hpp>
+#include <cstddef>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/buffers.hpp>
+
+using namespace vpnes::gui;
+
+BOOST_AUTO_TEST_CASE(ring_empty) {
+	CSPSCRing<int, 8> ring;
+	int items[8] = {};
+	BOOST_CHECK_EQUAL(ring.getCount(), 0);
+	BOOST_CHECK_EQUAL(ring.read(items, 8), 0);
+	BOOST_CHECK_EQUAL(ring.getReadCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ring_full) {
+	CSPSCRing<int, 8> ring;
+	int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	BOOST_CHECK_EQUAL(ring.write(items, 10), 8);
+	BOOST_CHECK_EQUAL(ring.getCount(), 8);
+	BOOST_CHECK_EQUAL(ring.write(items, 1), 0);
+	int read[10] = {};
+	BOOST_CHECK_EQUAL(ring.read(read, 10), 8);
+	for (int i = 0; i < 8; i++) {
+		BOOST_CHECK_EQUAL(read[i], i);
+	}
+	BOOST_CHECK_EQUAL(ring.getCount(), 0);
+	BOOST_CHECK_EQUAL(ring.getReadCount(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(ring_wraparound) {
+	CSPSCRing<int, 8> ring;
+	int next = 0, expected = 0;
+	// Uneven sizes move the boundary across every slot
+	for (std::size_t round = 0; round < 100; round++) {
+		int items[5];
+		for (int &item : items) {
+			item = next++;
+		}
+		std::size_t written = ring.write(items, 5);
+		next -= 5 - static_cast<int>(written);
+		int read[3];
+		std::size_t count = ring.read(read, 3);
+		for (std::size_t i = 0; i < count; i++) {
+			BOOST_REQUIRE_EQUAL(read[i], expected++);
+		}
+		BOOST_REQUIRE_EQUAL(ring.getCount(), next - expected);
+	}
+	BOOST_CHECK_EQUAL(ring.getReadCount(), expected);
+}
@@ -0,0 +1,268 @@
+/**
+ * @file
+ * Tests loading of ROM images
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/apu_channels.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/image.hpp>
+#include <vpnes/core/ines.hpp>
+#include <vpnes/core/ppu_render.hpp>
+
+using namespace vpnes::core;
+
+/**
+ * Temporary file removed at scope exit
+ */
+struct STemporaryFile {
+	/**
+	 * File path
+	 */
+	std::string Path;
+
+	/**
+	 * Writes the file
+	 *
+	 * @param name File name
+	 * @param data Contents
+	 */
+	STemporaryFile(const std::string &name, const std::vector<char> &data)
+	    : Path((std::filesystem::temp_directory_path() / name).string()) {
+		std::ofstream file(Path, std::ios_base::binary);
+		file.write(data.data(), data.size());
+	}
+	/**
+	 * Removes the file
+	 */
+	~STemporaryFile() {
+		std::filesystem::remove(Path);
+	}
+};
+
+/**
+ * Gets an iNES file with one PRG and one CHR bank
+ *
+ * @return File contents
+ */
+std::vector<char> getROMData() {
+	std::vector<char> data(16 + 0x4000 + 0x2000);
+	const char header[] = {'N', 'E', 'S', 0x1a, 1, 1};
+	std::copy(header, header + sizeof(header), data.begin());
+	for (std::size_t i = 16; i < data.size(); i++) {
+		data[i] = static_cast<char>(i);
+	}
+	return data;
+}
+
+/**
+ * Checks exception message
+ *
+ * @param message Expected message
+ * @return Predicate for BOOST_CHECK_EXCEPTION
+ */
+auto hasMessage(const std::string &message) {
+	return [message](const std::invalid_argument &e) {
+		return e.what() == message;
+	};
+}
+
+BOOST_AUTO_TEST_CASE(image_missing) {
+	std::string path =
+	    (std::filesystem::temp_directory_path() / "vpnes-missing.nes")
+	        .string();
+	std::filesystem::remove(path);
+	BOOST_CHECK_EXCEPTION(CROMImage image(path), std::invalid_argument,
+	    hasMessage("Cannot open " + path));
+}
+
+BOOST_AUTO_TEST_CASE(image_empty) {
+	STemporaryFile file("vpnes-empty.nes", {});
+	CROMImage image(file.Path);
+	BOOST_CHECK_EQUAL(image.getSize(), 0);
+	BOOST_CHECK_EXCEPTION(ines::SNESData ROM(image), std::invalid_argument,
+	    hasMessage("Unknown file format"));
+}
+
+BOOST_AUTO_TEST_CASE(image_truncated) {
+	std::vector<char> data = getROMData();
+	// Header only, and one byte short of CHR
+	for (std::size_t size : {std::size_t(16), data.size() - 1}) {
+		STemporaryFile file(
+		    "vpnes-truncated.nes", {data.begin(), data.begin() + size});
+		CROMImage image(file.Path);
+		BOOST_CHECK_EQUAL(image.getSize(), size);
+		BOOST_CHECK_EXCEPTION(ines::SNESData ROM(image),
+		    std::invalid_argument, hasMessage("Unexpected end of file"));
+	}
+	// Header is cut
+	STemporaryFile file(
+	    "vpnes-truncated.nes", {data.begin(), data.begin() + 8});
+	CROMImage image(file.Path);
+	BOOST_CHECK_EXCEPTION(ines::SNESData ROM(image), std::invalid_argument,
+	    hasMessage("Unknown file format"));
+}
+
+BOOST_AUTO_TEST_CASE(image_mapped) {
+	std::vector<char> data = getROMData();
+	STemporaryFile file("vpnes-mapped.nes", data);
+	CROMImage image(file.Path);
+	ines::SNESData ROM(image);
+	BOOST_CHECK_EQUAL(ROM.PRGSize, 0x4000);
+	BOOST_CHECK_EQUAL(ROM.CHRSize, 0x2000);
+	// ROM banks point into the mapped file
+	BOOST_CHECK(ROM.PRG == image.getData() + 16);
+	BOOST_CHECK(ROM.CHR == image.getData() + 16 + 0x4000);
+}
+
+BOOST_AUTO_TEST_CASE(image_tiles) {
+	std::vector<char> data = getROMData();
+	STemporaryFile file("vpnes-tiles.nes", data);
+	CROMImage image(file.Path);
+	const ppu::CTileCache &tiles = image.getTiles(16 + 0x4000);
+	BOOST_CHECK(&image.getTiles(16 + 0x4000) == &tiles);
+	// Every tile matches one decoded on first use
+	ppu::CTileCache expected;
+	const std::uint8_t *patterns = image.getData() + 16 + 0x4000;
+	for (std::uint16_t addr = 0; addr < 0x2000; addr++) {
+		BOOST_REQUIRE(tiles.isValid(addr));
+		if (!expected.isValid(addr)) {
+			expected.update(addr, patterns + (addr & 0x1ff0));
+		}
+		for (bool flip : {false, true}) {
+			BOOST_CHECK(std::equal(tiles.getRow(addr, flip),
+			    tiles.getRow(addr, flip) + ppu::TileWidth,
+			    expected.getRow(addr, flip)));
+		}
+	}
+}
+
+/**
+ * Number of calls to getCountingHash
+ */
+std::size_t hashCalls;
+
+/**
+ * Hash that counts its calls
+ *
+ * @param image ROM image
+ * @return Same value for every image
+ */
+std::uint64_t getCountingHash(const CROMImage &image) {
+	hashCalls++;
+	return 0;
+}
+
+/**
+ * Hash that makes all images collide
+ *
+ * @param image ROM image
+ * @return Same value for every image
+ */
+std::uint64_t getCollidingHash(const CROMImage &image) {
+	return 0;
+}
+
+BOOST_AUTO_TEST_CASE(registry_shared) {
+	std::vector<char> data = getROMData();
+	STemporaryFile first("vpnes-shared-1.nes", data);
+	STemporaryFile second("vpnes-shared-2.nes", data);
+	CROMRegistry registry;
+	auto image = registry.getImage(first.Path);
+	BOOST_CHECK(registry.getImage(second.Path) == image);
+	BOOST_CHECK_EQUAL(registry.getCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(registry_collision) {
+	std::vector<char> data = getROMData();
+	STemporaryFile first("vpnes-collision-1.nes", data);
+	data.back()++;
+	STemporaryFile second("vpnes-collision-2.nes", data);
+	// Same size and hash, contents differ in the last byte
+	CROMRegistry registry(getCollidingHash);
+	auto firstImage = registry.getImage(first.Path);
+	auto secondImage = registry.getImage(second.Path);
+	BOOST_CHECK(firstImage != secondImage);
+	BOOST_CHECK_EQUAL(registry.getCount(), 2);
+	BOOST_CHECK(registry.getImage(first.Path) == firstImage);
+	BOOST_CHECK(registry.getImage(second.Path) == secondImage);
+}
+
+BOOST_AUTO_TEST_CASE(registry_expired) {
+	std::vector<char> data = getROMData();
+	STemporaryFile first("vpnes-expired-1.nes", data);
+	data.back()++;
+	STemporaryFile second("vpnes-expired-2.nes", data);
+	CROMRegistry registry;
+	registry.getImage(first.Path);
+	BOOST_CHECK_EQUAL(registry.getCount(), 1);
+	// The unused first image is dropped when the second one is added
+	auto image = registry.getImage(second.Path);
+	BOOST_CHECK_EQUAL(registry.getCount(), 1);
+	BOOST_CHECK(registry.getImage(second.Path) == image);
+}
+
+BOOST_AUTO_TEST_CASE(registry_identity) {
+	std::vector<char> data = getROMData();
+	STemporaryFile first("vpnes-identity-1.nes", data);
+	STemporaryFile second("vpnes-identity-2.nes", data);
+	hashCalls = 0;
+	CROMRegistry registry(getCountingHash);
+	auto image = registry.getImage(first.Path);
+	BOOST_CHECK_EQUAL(hashCalls, 1);
+	// The same file is found by identity without hashing
+	BOOST_CHECK(registry.getImage(first.Path) == image);
+	BOOST_CHECK_EQUAL(hashCalls, 1);
+	// A copy is hashed once and then found by identity too
+	BOOST_CHECK(registry.getImage(second.Path) == image);
+	BOOST_CHECK_EQUAL(hashCalls, 2);
+	BOOST_CHECK(registry.getImage(second.Path) == image);
+	BOOST_CHECK_EQUAL(hashCalls, 2);
+	BOOST_CHECK_EQUAL(registry.getCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(registry_changed) {
+	std::vector<char> data = getROMData();
+	STemporaryFile file("vpnes-changed.nes", data);
+	CROMRegistry registry;
+	auto image = registry.getImage(file.Path);
+	// Rewritten in place with other size, so the identity differs
+	data.push_back(0);
+	std::ofstream(file.Path, std::ios_base::binary)
+	    .write(data.data(), data.size());
+	auto changed = registry.getImage(file.Path);
+	BOOST_CHECK(changed != image);
+	BOOST_CHECK_EQUAL(changed->getSize(), data.size());
+}
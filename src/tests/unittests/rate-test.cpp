@@ -0,0 +1,93 @@
+/**
+ * @file
+ * Tests audio rate control
+ */
+/*
+ NES Emulator
+ Copyright (C) 2012-2018  Ivanov Viktor
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/core/apu_channels.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vpnes/vpnes.hpp>
+#include <vpnes/gui/rate.hpp>
+
+using namespace vpnes::gui;
+
+/**
+ * Target fill level used in tests
+ */
+const double rateTarget = 1536;
+
+/**
+ * Simulates a buffer filled with a rate control and drained by a device
+ *
+ * The rate must stay within 1 / CRateControl::MaxAdjust of nominal, and
+ * after a second the fill must be closer to the target than at start.
+ *
+ * @param fill Initial fill level
+ * @param drift Relative speed of producer clock to device clock
+ * @param excursion Largest distance from the target
+ * @return Fill level after a minute
+ */
+double simulateRate(double fill, double drift, double &excursion) {
+	const double block = 800;
+	CRateControl control(static_cast<std::size_t>(rateTarget));
+	double error = std::abs(fill - rateTarget);
+	excursion = error;
+	for (int frame = 1; frame <= 3600; frame++) {
+		fill += block * control.getRatio() * drift - block;
+		control.update(static_cast<std::size_t>(fill));
+		BOOST_REQUIRE_LE(std::abs(control.getRatio() - 1.0),
+		    1.0 / CRateControl::MaxAdjust + 1e-9);
+		excursion = std::max(excursion, std::abs(fill - rateTarget));
+		if (frame == 60 && error > 0) {
+			BOOST_REQUIRE_LT(std::abs(fill - rateTarget), error);
+		}
+	}
+	return fill;
+}
+
+BOOST_AUTO_TEST_CASE(rate_overfilled) {
+	double excursion;
+	BOOST_CHECK_CLOSE(simulateRate(3000, 1.0, excursion), rateTarget, 1);
+}
+
+BOOST_AUTO_TEST_CASE(rate_underfilled) {
+	double excursion;
+	BOOST_CHECK_CLOSE(simulateRate(800, 1.0, excursion), rateTarget, 1);
+}
+
+BOOST_AUTO_TEST_CASE(rate_drift) {
+	// 0.3% clock mismatch is absorbed without draining the buffer
+	for (double drift : {1.003, 0.997}) {
+		double excursion;
+		BOOST_CHECK_CLOSE(simulateRate(rateTarget, drift, excursion),
+		    rateTarget, 1);
+		BOOST_CHECK_LT(excursion, rateTarget / 2);
+	}
+}